@@ -0,0 +1,363 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	Benchmarks the simulator on fixed scenarios and compares them with a stored
+	baseline, so physics and scheduler changes show what they cost.
+
+	Usage:
+		./bench.o                 Runs every scenario and prints a line for each
+		    -c <file>             Compares with a baseline file
+		    -w <file>             Writes the results as the new baseline
+		    -r <repeats>          Timed repeats per scenario, the fastest is kept
+
+	Every scenario runs in two modes. "stepped" calls stepMachine() once per
+	cycle, timing the physics alone. "headless" calls runMachineHeadless() on a
+	thousand machines, timing the physics together with the next-event skip and
+	cycle detection, as batch runs use them.
+
+	Allocations are counted by wrapping malloc(), calloc() and realloc() at link
+	time, see the bench target in the Makefile. The memory high-water mark is the
+	process's peak resident set size so far.
+
+	The baseline holds the same lines the benchmark prints. Allocation counts
+	should match it exactly, throughput is compared as a percentage.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "machine.h"
+
+
+#define DEFAULT_REPEATS 5
+#define STEPPED_CYCLES 10000000L
+#define HEADLESS_RUNS 1000 //Headless runs finish in microseconds, so many are timed together
+#define HEADLESS_CYCLES 1000000L
+#define SLOWER_WARNING 15.0 //Percent slower than the baseline worth flagging
+#define MAX_BASELINE_LINES 64
+#define BENCH_LINE_LENGTH 512
+#define BENCH_NAME_LENGTH 32
+
+
+//––––––  Private Types  ––––––//
+typedef struct BenchScenario {
+	const char* name;
+	void (*setup)(Machine* m);
+} BenchScenario;
+
+typedef struct BenchResult {
+	char scenario[BENCH_NAME_LENGTH];
+	char mode[BENCH_NAME_LENGTH];
+	long cycles;
+	double seconds;
+	double cyclesPerSec;
+	long allocs; //Allocations per machine, including building and freeing it
+	long allocBytes;
+	long maxRssKb;
+} BenchResult;
+
+
+//––––––  Private Declarations  ––––––//
+long allocCount;
+long allocBytes;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* block, size_t size);
+void setupDefault(Machine* m);
+void setupLongIdle(Machine* m);
+void setupHeavyReject(Machine* m);
+void setupInfinitePower(Machine* m);
+BenchResult runBench(const BenchScenario* scenario, int headless, int repeats);
+int readBaseline(const char* path, BenchResult baseline[], int max);
+int parseResult(const char* line, BenchResult* result);
+void printResult(FILE* out, const BenchResult* result);
+void compareResult(const BenchResult* result, const BenchResult baseline[], int count);
+double wallSeconds(void);
+void printUsage(char* name);
+
+
+static const BenchScenario scenarios[] = {
+	{"default", setupDefault},
+	{"long_idle", setupLongIdle},
+	{"heavy_reject", setupHeavyReject},
+	{"infinite_power", setupInfinitePower},
+};
+
+
+int main(int argc, char* argv[]) {
+	BenchResult baseline[MAX_BASELINE_LINES];
+	BenchResult results[2 * sizeof(scenarios) / sizeof(scenarios[0])];
+	char* comparePath = NULL;
+	char* writePath = NULL;
+	FILE* out;
+	int repeats = DEFAULT_REPEATS;
+	int baselineCount = 0;
+	int count = 0, i, headless, opt;
+
+	while ((opt = getopt(argc, argv, "c:w:r:h")) != -1) {
+		switch (opt) {
+			case 'c':
+				comparePath = optarg;
+				break;
+			case 'w':
+				writePath = optarg;
+				break;
+			case 'r':
+				repeats = atoi(optarg);
+				break;
+			default:
+				printUsage(argv[0]);
+				return opt == 'h' ? 0 : 1;
+		}
+	}
+	if (repeats < 1) {
+		printUsage(argv[0]);
+		return 1;
+	}
+	if (comparePath && (baselineCount = readBaseline(comparePath, baseline, MAX_BASELINE_LINES)) < 0) {
+		printf("Could not read a baseline from %s\n", comparePath);
+		return 1;
+	}
+
+	for (i=0; i < (int)(sizeof(scenarios) / sizeof(scenarios[0])); i++) {
+		for (headless=0; headless <= 1; headless++) {
+			results[count] = runBench(&scenarios[i], headless, repeats);
+			printResult(stdout, &results[count]);
+			if (comparePath) {
+				compareResult(&results[count], baseline, baselineCount);
+			}
+			count++;
+		}
+	}
+
+	if (writePath) {
+		if ((out = fopen(writePath, "w")) == NULL) {
+			printf("Could not write a baseline to %s\n", writePath);
+			return 1;
+		}
+		for (i=0; i < count; i++) {
+			printResult(out, &results[i]);
+		}
+		fclose(out);
+		printf("baseline=%s lines=%d\n", writePath, count);
+	}
+	return 0;
+}
+
+
+//––––––––––––––––––––––––––––––  Allocation Counting  ––––––––––––––––––––––––––––––//
+
+void* __wrap_malloc(size_t size) {
+	allocCount++;
+	allocBytes += size;
+	return __real_malloc(size);
+}
+
+
+void* __wrap_calloc(size_t count, size_t size) {
+	allocCount++;
+	allocBytes += count * size;
+	return __real_calloc(count, size);
+}
+
+
+void* __wrap_realloc(void* block, size_t size) {
+	allocCount++;
+	allocBytes += size;
+	return __real_realloc(block, size);
+}
+
+
+//––––––––––––––––––––––––––––––  Private Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]	The default machine as it is.
+*/
+void setupDefault(Machine* m) {
+	(void) m;
+}
+
+
+/*
+[desc]	A weak recharge, so the machine spends most of its time idle waiting for the
+		battery.
+*/
+void setupLongIdle(Machine* m) {
+	m->rechargePerCycle = 1;
+}
+
+
+/*
+[desc]	The RO pump rejects four times as much water as it lets through.
+*/
+void setupHeavyReject(Machine* m) {
+	m->devices[DEVICE_RO_REJECT]->flowRate = 4 * m->devices[DEVICE_RO_PUMP]->flowRate;
+}
+
+
+/*
+[desc]	Infinite energy, so the machine never waits for the battery.
+*/
+void setupInfinitePower(Machine* m) {
+	togglePower(m);
+}
+
+
+/*
+[desc]	Times a scenario, keeping the fastest of a number of repeats. Every repeat
+		builds, runs and frees its own machines.
+
+[scenario] The scenario to run.
+[headless] 1 to run HEADLESS_RUNS machines with runMachineHeadless(), 0 to run one
+		calling stepMachine() every cycle.
+[repeats] Number of timed repeats.
+
+[ret]	The result of the fastest repeat.
+*/
+BenchResult runBench(const BenchScenario* scenario, int headless, int repeats) {
+	BenchResult result = {};
+	struct rusage usage;
+	Machine* m;
+	double start, elapsed;
+	long i, cycle, runs = headless ? HEADLESS_RUNS : 1;
+
+	snprintf(result.scenario, BENCH_NAME_LENGTH, "%s", scenario->name);
+	snprintf(result.mode, BENCH_NAME_LENGTH, "%s", headless ? "headless" : "stepped");
+	result.cycles = headless ? HEADLESS_RUNS * HEADLESS_CYCLES : STEPPED_CYCLES;
+	for (; repeats > 0; repeats--) {
+		allocCount = 0;
+		allocBytes = 0;
+		start = wallSeconds();
+		for (i=0; i < runs; i++) {
+			m = defaultMachine();
+			scenario->setup(m);
+			if (headless) {
+				runMachineHeadless(m, HEADLESS_CYCLES);
+			} else {
+				for (cycle=0; cycle < STEPPED_CYCLES; cycle++) {
+					stepMachine(m);
+				}
+			}
+			freeMachine(m);
+		}
+		elapsed = wallSeconds() - start;
+		if (result.seconds == 0 || elapsed < result.seconds) {
+			result.seconds = elapsed;
+		}
+		result.allocs = allocCount / runs;
+		result.allocBytes = allocBytes / runs;
+	}
+	result.cyclesPerSec = result.seconds > 0 ? result.cycles / result.seconds : 0.0;
+	getrusage(RUSAGE_SELF, &usage);
+	result.maxRssKb = usage.ru_maxrss;
+	return result;
+}
+
+
+/*
+[desc]	Reads a baseline file written with -w.
+
+[path] File to read.
+[baseline] Filled with the results found.
+[max] Size of baseline.
+
+[ret]	Number of results read, or -1 if the file could not be opened.
+*/
+int readBaseline(const char* path, BenchResult baseline[], int max) {
+	char line[BENCH_LINE_LENGTH];
+	FILE* file = fopen(path, "r");
+	int count = 0;
+	if (file == NULL) {
+		return -1;
+	}
+	while (count < max && fgets(line, sizeof(line), file)) {
+		count += parseResult(line, &baseline[count]);
+	}
+	fclose(file);
+	return count;
+}
+
+
+/*
+[desc]	Parses one line printed by printResult().
+
+[line] The line.
+[result] Filled in on success.
+
+[ret]	1 on success, 0 if the line is not a result.
+*/
+int parseResult(const char* line, BenchResult* result) {
+	memset(result, 0, sizeof(BenchResult));
+	return sscanf(line, "scenario=%31s mode=%31s cycles=%ld seconds=%lf cycles_per_sec=%lf allocs=%ld "
+			"alloc_bytes=%ld max_rss_kb=%ld", result->scenario, result->mode, &result->cycles,
+			&result->seconds, &result->cyclesPerSec, &result->allocs, &result->allocBytes,
+			&result->maxRssKb) == 8;
+}
+
+
+/*
+[desc]	Prints a result as one line of key=value pairs.
+
+[out] Stream to print to.
+[result] The result to print.
+*/
+void printResult(FILE* out, const BenchResult* result) {
+	fprintf(out, "scenario=%s mode=%s cycles=%ld seconds=%.6f cycles_per_sec=%.0f allocs=%ld "
+			"alloc_bytes=%ld max_rss_kb=%ld\n", result->scenario, result->mode, result->cycles,
+			result->seconds, result->cyclesPerSec, result->allocs, result->allocBytes, result->maxRssKb);
+}
+
+
+/*
+[desc]	Prints how a result compares with the matching line of the baseline, flagging
+		changed allocation counts and big slowdowns.
+
+[result] The result to compare.
+[baseline] The baseline's results.
+[count] Number of baseline results.
+*/
+void compareResult(const BenchResult* result, const BenchResult baseline[], int count) {
+	const BenchResult* base = NULL;
+	double change;
+	int i;
+
+	for (i=0; i < count && base == NULL; i++) {
+		if (!strcmp(baseline[i].scenario, result->scenario) && !strcmp(baseline[i].mode, result->mode)) {
+			base = &baseline[i];
+		}
+	}
+	if (base == NULL || base->cyclesPerSec <= 0) {
+		printf("\tno baseline\n");
+		return;
+	}
+	change = (result->cyclesPerSec / base->cyclesPerSec - 1.0) * 100;
+	printf("\tbaseline_cycles_per_sec=%.0f change=%+.1f%% allocs_change=%+ld%s%s\n", base->cyclesPerSec,
+			change, result->allocs - base->allocs, change < -SLOWER_WARNING ? " SLOWER" : "",
+			result->allocs != base->allocs ? " ALLOCS" : "");
+}
+
+
+/*
+[desc]	Returns a monotonic wall clock reading in seconds.
+*/
+double wallSeconds(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+/*
+[desc]	Prints the command line options.
+*/
+void printUsage(char* name) {
+	printf("Usage: %s [-c baseline] [-w baseline] [-r repeats]\n", name);
+}
+
+
+/* EOF */
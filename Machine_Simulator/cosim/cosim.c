@@ -0,0 +1,222 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	Runs the CYKIT59 firmware's control logic against the default machine, much
+	faster than real time, and prints a key=value summary like main.o -b.
+
+	Usage:
+		./cosim.o                 One simulated week in mid power mode
+		    -d <days>             Simulated days to run
+		    -m <high|mid|low>     Firmware power mode
+		    -l <loops>            Firmware control loops per simulated hour
+		    -i                    Infinite energy
+		    -o <file>             Records every cycle to a trace, see trace.h
+
+	Pins map onto the machine's devices once per cycle: Pump0 runs the filter
+	pump, Pump1 the RO pump and its reject line, and Pump2 the UV device, which
+	draws from the disinfected tank instead while recirculating. The slow drain
+	always runs, standing in for water being used. Float switches follow the
+	simulator's full and low thresholds.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "machine.h"
+#include "trace.h"
+#include "cosim.h"
+
+
+#define DEFAULT_DAYS 7
+#define DEFAULT_LOOPS_PER_CYCLE 60
+#define BATTERY_EMPTY_VOLTS 22.8 //24 V bank at no charge
+#define BATTERY_SPAN_VOLTS 2.4 //Rise from empty to full charge
+#define PANEL_AMPS 45.0 //Panel current in daylight
+#define EC_PER_TURBIDITY 100.0 //Conductivity in uS/cm per unit of turbidity
+#define DISSOLVED_OXYGEN 8.0 //mg/L, saturated water at about 20 C
+
+
+//––––––  Private Declarations  ––––––//
+Machine* cosimMachine;
+double pendingMs; //Simulated time not yet stepped
+long pumpHours[3];
+
+void applyPins(Machine* m);
+double wallSeconds(void);
+void printUsage(char* name);
+
+
+int main(int argc, char* argv[]) {
+	long days = DEFAULT_DAYS;
+	int loopsPerCycle = DEFAULT_LOOPS_PER_CYCLE;
+	CosimPowerModes mode = COSIM_MID_POWER;
+	char* modeNames[] = {"high", "mid", "low"};
+	int infinitePower = 0;
+	char* tracePath = NULL;
+	TraceWriter* trace = NULL;
+	MachineStats stats;
+	double start, elapsed, loopMs;
+	long loops, cycles;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:m:l:io:h")) != -1) {
+		switch (opt) {
+			case 'd':
+				days = atol(optarg);
+				break;
+			case 'm':
+				if (strcmp(optarg, "high") == 0) {
+					mode = COSIM_HIGH_POWER;
+				} else if (strcmp(optarg, "low") == 0) {
+					mode = COSIM_LOW_POWER;
+				} else if (strcmp(optarg, "mid") == 0) {
+					mode = COSIM_MID_POWER;
+				} else {
+					printUsage(argv[0]);
+					return 1;
+				}
+				break;
+			case 'l':
+				loopsPerCycle = atoi(optarg);
+				break;
+			case 'i':
+				infinitePower = 1;
+				break;
+			case 'o':
+				tracePath = optarg;
+				break;
+			default:
+				printUsage(argv[0]);
+				return opt == 'h' ? 0 : 1;
+		}
+	}
+	if (days < 1 || loopsPerCycle < 1) {
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	cosimMachine = defaultMachine();
+	if (infinitePower) {
+		togglePower(cosimMachine);
+	}
+	cosimMachine->devices[DEVICE_DRAIN]->enable = 1;
+	if (tracePath) {
+		if ((trace = traceWriter(tracePath, cosimMachine)) == NULL) {
+			printf("Could not trace to %s\n", tracePath);
+			return 1;
+		}
+		cosimMachine->trace = trace;
+	}
+
+	cycles = days * CYCLES_PER_DAY;
+	loopMs = COSIM_MS_PER_CYCLE / loopsPerCycle;
+	start = wallSeconds();
+	firmwareInit(mode);
+	for (loops=0; cosimMachine->totalCycles < cycles; loops++) {
+		firmwareLoop();
+		cosimAdvance(loopMs);
+	}
+	elapsed = wallSeconds() - start;
+
+	cosimMachine->trace = NULL;
+	freeTraceWriter(trace);
+	stats = machineStats(cosimMachine);
+	printf("mode=%s cycles=%ld idle_cycles=%ld device_cycles=%ld water_purified=%ld "
+			"water_rejected=%ld battery=%d/%d pump0_hours=%ld pump1_hours=%ld pump2_hours=%ld "
+			"firmware_loops=%ld seconds=%.6f speedup=%.0f\n",
+			modeNames[mode], stats.totalCycles, stats.idleCycles, stats.deviceCycles,
+			stats.waterPurified, stats.waterRejected, stats.batteryRemaining, stats.batteryMax,
+			pumpHours[0], pumpHours[1], pumpHours[2], loops, elapsed,
+			elapsed > 0 ? stats.totalCycles * COSIM_MS_PER_CYCLE / 1000.0 / elapsed : 0.0);
+	freeMachine(cosimMachine);
+	return 0;
+}
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+void cosimPhysics(double milliseconds) {
+	pendingMs += milliseconds;
+	while (pendingMs >= COSIM_MS_PER_CYCLE) {
+		pendingMs -= COSIM_MS_PER_CYCLE;
+		applyPins(cosimMachine);
+		stepDevices(cosimMachine);
+		cosimTanksChanged();
+	}
+}
+
+
+int cosimTankState(int tank) {
+	Tank* t = cosimMachine->tanks[TANK_SOURCE + tank];
+	if (isFull(t)) {
+		return 2;
+	} else if (isEmpty(t)) {
+		return 0;
+	}
+	return 1;
+}
+
+
+double cosimBatteryVolts(void) {
+	Battery* b = cosimMachine->mainBattery;
+	return BATTERY_EMPTY_VOLTS + BATTERY_SPAN_VOLTS * b->remaining / b->max;
+}
+
+
+double cosimPanelAmps(void) {
+	return cosimMachine->daytime ? PANEL_AMPS : 0.0;
+}
+
+
+double cosimConductivity(void) {
+	return EC_PER_TURBIDITY * cosimMachine->tanks[TANK_DISINFECTED]->turbidity / TURBIDITY_SCALE;
+}
+
+
+double cosimDissolvedOxygen(void) {
+	return DISSOLVED_OXYGEN;
+}
+
+
+//––––––––––––––––––––––––––––––  Private Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]	Enables the machine's devices from the firmware's pins for the coming cycle,
+		and counts the hours each pump runs.
+
+[m] The machine to drive.
+*/
+void applyPins(Machine* m) {
+	m->devices[DEVICE_FILTER_PUMP]->enable = cosimPins.pump0 != 0;
+	m->devices[DEVICE_RO_PUMP]->enable = cosimPins.pump1 != 0;
+	m->devices[DEVICE_RO_REJECT]->enable = cosimPins.pump1 != 0;
+	m->devices[DEVICE_UV]->enable = cosimPins.pump2 != 0;
+	m->devices[DEVICE_UV]->source = m->tanks[cosimPins.recirculate ? TANK_DISINFECTED : TANK_PERMEATE];
+	pumpHours[0] += cosimPins.pump0 != 0;
+	pumpHours[1] += cosimPins.pump1 != 0;
+	pumpHours[2] += cosimPins.pump2 != 0;
+}
+
+
+/*
+[desc]	Returns a monotonic wall clock reading in seconds.
+*/
+double wallSeconds(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+/*
+[desc]	Prints the command line options.
+*/
+void printUsage(char* name) {
+	printf("Usage: %s [-d days] [-m high|mid|low] [-l loops] [-i] [-o trace]\n", name);
+}
+
+
+/* EOF */
@@ -0,0 +1,117 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	Co-simulation of the CYKIT59 firmware against the machine simulator. The
+	firmware's control code is compiled for the host (firmware.c) and linked
+	against shims: PSoC components in psoc.c, and the tank, EZO, Tristar, USB,
+	pressure and setup shell libraries in shims.c. The shims are backed by a
+	machine from machine.c, driven by cosim.c.
+
+	The firmware's main() never leaves its debug loop, so it is not run. Instead
+	firmwareInit() repeats its setup and firmwareLoop() one pass of its control
+	loop, both calling the firmware's own control functions and ISRs.
+
+	This header is the narrow interface between the two sides. It is kept free of
+	both machine.h and the firmware headers since each defines its own
+	MAX_TANK_COUNT.
+
+	Time: one machine cycle is one simulated hour, as in the simulator. Firmware
+	delays, timer interrupts and the control loop all run on a simulated
+	millisecond clock that steps the machine every time an hour passes.
+*/
+
+#ifndef COSIM_H
+#define COSIM_H
+
+
+#define COSIM_MS_PER_CYCLE (60.0 * 60.0 * 1000.0) //One simulated hour
+
+/* Same order as the firmware's POWER_MODES */
+typedef enum {
+	COSIM_HIGH_POWER,
+	COSIM_MID_POWER,
+	COSIM_LOW_POWER,
+} CosimPowerModes;
+
+/* Outputs driven by the firmware, written by the pin shims */
+typedef struct CosimPins {
+	int pump0; //Filter pump
+	int pump1; //RO pump
+	int pump2; //UV pump
+	int uv; //UV lamp
+	int bubbler;
+	int led;
+	int recirculate; //UV loop recirculates the disinfected tank, set by toggleRecirculation()
+} CosimPins;
+
+extern CosimPins cosimPins;
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]	Sets up the firmware as its main() does and enters a power mode. Defined in
+		firmware.c.
+
+[mode] Power mode to run in. The firmware never changes it on its own.
+*/
+void firmwareInit(CosimPowerModes mode);
+
+/*
+[desc]	One pass of the firmware's control loop: the power mode's control function
+		followed by the conductivity guard. Defined in firmware.c.
+*/
+void firmwareLoop(void);
+
+/*
+[desc]	Lets simulated time pass. Fires timer interrupts when they come due and steps
+		the machine at every hour boundary, in time order. Defined in psoc.c.
+
+[milliseconds] Simulated time to pass.
+*/
+void cosimAdvance(double milliseconds);
+
+/*
+[desc]	Advances the machine's clock. Steps the machine once for every full hour
+		accumulated. Defined in cosim.c.
+
+[milliseconds] Simulated time that passed.
+*/
+void cosimPhysics(double milliseconds);
+
+/*
+[desc]	Called after every machine step so the float switch shim can raise tank
+		events. Defined in shims.c.
+*/
+void cosimTanksChanged(void);
+
+/*
+[desc]	Float switch reading for a firmware tank index, 0 to 3.
+
+[ret]	0 for empty, 1 for mid and 2 for full, the order of the firmware's TankStates.
+*/
+int cosimTankState(int tank);
+
+/*
+[desc]	Battery voltage of a 24 V bank at the machine's state of charge.
+*/
+double cosimBatteryVolts(void);
+
+/*
+[desc]	Solar panel current, nonzero during the day.
+*/
+double cosimPanelAmps(void);
+
+/*
+[desc]	Conductivity of the disinfected tank in uS/cm, modelled from its turbidity.
+*/
+double cosimConductivity(void);
+
+/*
+[desc]	Dissolved oxygen of the disinfected tank in mg/L.
+*/
+double cosimDissolvedOxygen(void);
+
+
+#endif //COSIM_H
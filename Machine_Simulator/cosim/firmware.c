@@ -0,0 +1,87 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	The CYKIT59 firmware compiled for the host. Its main() is renamed out of the
+	way and never called, since it never leaves its debug loop. The setup and
+	control loop below follow it line for line, minus the USB setup shell.
+*/
+
+#include "cosim.h"
+
+#define main firmwareMain
+#include "CYKIT59.cydsn/main.c"
+#undef main
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+void firmwareInit(CosimPowerModes mode) {
+	Timer_Recirculate_Start();
+	Timer_Recirculate_Sleep();
+	Recirculate_Interrupt_StartEx(Recirculate_Isr);
+	Solenoid_Select_Write(0);
+	Solenoid_Signal_Write(1);
+	CyDelay(50); //Length of signal to toggle solenoid
+	Solenoid_Signal_Write(0);
+
+	Timer_Watchdog_Start();
+	Watchdog_Interrupt_StartEx(Watchdog_ISR);
+
+	ADC_Pot_Start();
+	ADC_Pot_StartConvert();
+	PWM_0_Start();
+	PWM_1_Start();
+	PWM_2_Start();
+	PWM_3_Start();
+
+	tankInit();
+	ezoStart();
+	pressureInit();
+	tstarStart();
+
+	highVoltThreshold = HIGH_POWER_VOLT_THRESHOLD;
+	midVoltThreshold = MID_POWER_VOLT_THRESHOLD;
+	currentThreshold = HIGH_POWER_CURRENT_THRESHOLD;
+
+	powerMode = (enum POWER_MODES) mode;
+	if (powerMode == MID_POWER_MODE) {
+		midPowerInit();
+	} else if (powerMode == LOW_POWER_MODE) {
+		lowPowerInit();
+	}
+}
+
+
+void firmwareLoop(void) {
+	ezoRun();
+	tstarRun();
+	switch (powerMode) {
+		case HIGH_POWER_MODE:
+			runHighPower();
+			break;
+		case MID_POWER_MODE:
+			runMidPower();
+			break;
+		case LOW_POWER_MODE:
+			break;
+	}
+	ezoSetProcessActive(Pump0_En_Read() || Pump1_En_Read() || Pump2_En_Read()); /* Idle plants are sampled less */
+
+	/* The firmware spins here until conductivity drops. Only one pass is taken so
+	   a bad reading can't hang the host, the next loop checks again. */
+	if (ezoGetFixed(EC_SENSOR_ADDRESS, 0) > EZO_FIXED(EC_THRESHOLD)) {
+		usbLog("Warning", "EC threshold exceeded");
+		LED_Pin_Write(1);
+		Pump0_En_Write(FALSE);
+		Pump1_En_Write(FALSE);
+		Pump2_En_Write(FALSE);
+		UV_En_Write(FALSE);
+		pollWhileWaiting(1000);
+		return;
+	}
+	LED_Pin_Write(0);
+}
+
+
+/* EOF */
@@ -0,0 +1,84 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	Host stand-in for the PSoC Creator generated project.h, used when building
+	the CYKIT59 firmware against the simulator. Declares just the types, macros
+	and component APIs the firmware calls. The components are implemented in
+	psoc.c on top of the co-simulation clock.
+*/
+
+#ifndef PROJECT_H
+#define PROJECT_H
+
+#include <stdint.h>
+
+
+typedef uint8_t uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef int8_t int8;
+typedef int16_t int16;
+typedef int32_t int32;
+
+typedef void (*cyisraddress)(void);
+
+#define CY_ISR_PROTO(FuncName) void FuncName(void)
+#define CY_ISR(FuncName) void FuncName(void)
+#define CyGlobalIntEnable do {} while (0)
+
+#define ADC_Pot_WAIT_FOR_RESULT 1
+#define Timer_Recirculate_STATUS (Timer_Recirculate_ReadStatusRegister())
+#define Timer_Watchdog_STATUS (Timer_Watchdog_ReadStatusRegister())
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+/* Delays advance simulated time instead of waiting */
+void CyDelay(uint32 milliseconds);
+void CyDelayUs(uint16 microseconds);
+
+/* Digital pins */
+void Pump0_En_Write(uint8 value);
+uint8 Pump0_En_Read(void);
+void Pump1_En_Write(uint8 value);
+uint8 Pump1_En_Read(void);
+void Pump2_En_Write(uint8 value);
+uint8 Pump2_En_Read(void);
+void UV_En_Write(uint8 value);
+void Bubbler_En_Write(uint8 value);
+void LED_Pin_Write(uint8 value);
+uint8 SW1_Pin_Read(void);
+void Solenoid_Select_Write(uint8 value);
+void Solenoid_Signal_Write(uint8 value);
+
+/* Timers and their interrupts. Timer_Recirculate counts at 100 kHz. */
+void Timer_Recirculate_Start(void);
+void Timer_Recirculate_Sleep(void);
+void Timer_Recirculate_Wakeup(void);
+void Timer_Recirculate_WriteCounter(uint32 counter);
+void Timer_Recirculate_WritePeriod(uint32 period);
+uint8 Timer_Recirculate_ReadStatusRegister(void);
+void Recirculate_Interrupt_StartEx(cyisraddress address);
+void Timer_Watchdog_Start(void);
+uint8 Timer_Watchdog_ReadStatusRegister(void);
+void Watchdog_Interrupt_StartEx(cyisraddress address);
+
+/* Potentiometer ADC */
+void ADC_Pot_Start(void);
+void ADC_Pot_StartConvert(void);
+uint8 ADC_Pot_IsEndConversion(uint8 retMode);
+int8 ADC_Pot_GetResult8(void);
+void AMux_Pot_Select(uint8 channel);
+
+/* Pump PWMs */
+void PWM_0_Start(void);
+void PWM_1_Start(void);
+void PWM_2_Start(void);
+void PWM_3_Start(void);
+void PWM_0_WriteCompare(uint8 compare);
+void PWM_1_WriteCompare(uint8 compare);
+void PWM_2_WriteCompare(uint8 compare);
+
+
+#endif /* PROJECT_H */
@@ -0,0 +1,265 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	PSoC component shims for the co-simulation. Pins latch into cosimPins, the
+	timers run on the simulated clock and call their ISRs when they come due.
+*/
+
+#include <stddef.h>
+#include "project.h"
+#include "cosim.h"
+
+
+#define RECIRCULATE_COUNTS_PER_MS 100.0 //Timer_Recirculate's 100 kHz clock
+#define WATCHDOG_PERIOD_MS 2000.0 //Matches the EZO polling period
+#define PWM_COUNT 4
+
+
+CosimPins cosimPins;
+
+
+//––––––  Private Types/Declarations  ––––––//
+typedef struct Timer {
+	int running;
+	double counter; //Counts since the last reload
+	double period; //Counts per interrupt
+	double countsPerMs;
+	cyisraddress isr;
+} Timer;
+
+Timer recirculateTimer = {0, 0, 0, RECIRCULATE_COUNTS_PER_MS, NULL};
+Timer watchdogTimer = {0, 0, WATCHDOG_PERIOD_MS, 1.0, NULL};
+int inInterrupt = 0;
+uint8 pwmCompare[PWM_COUNT];
+
+double timerDue(Timer* t);
+void timerRun(Timer* t, double milliseconds);
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+void cosimAdvance(double milliseconds) {
+	double step, recirculateDue, watchdogDue;
+
+	while (milliseconds > 0) {
+		recirculateDue = inInterrupt ? milliseconds : timerDue(&recirculateTimer);
+		watchdogDue = inInterrupt ? milliseconds : timerDue(&watchdogTimer);
+		step = milliseconds;
+		if (recirculateDue < step) {
+			step = recirculateDue;
+		}
+		if (watchdogDue < step) {
+			step = watchdogDue;
+		}
+
+		cosimPhysics(step);
+		timerRun(&recirculateTimer, step);
+		timerRun(&watchdogTimer, step);
+		milliseconds -= step;
+	}
+}
+
+
+void CyDelay(uint32 milliseconds) {
+	cosimAdvance(milliseconds);
+}
+
+
+void CyDelayUs(uint16 microseconds) {
+	cosimAdvance(microseconds / 1000.0);
+}
+
+
+void Pump0_En_Write(uint8 value) {
+	cosimPins.pump0 = value;
+}
+
+
+uint8 Pump0_En_Read(void) {
+	return cosimPins.pump0;
+}
+
+
+void Pump1_En_Write(uint8 value) {
+	cosimPins.pump1 = value;
+}
+
+
+uint8 Pump1_En_Read(void) {
+	return cosimPins.pump1;
+}
+
+
+void Pump2_En_Write(uint8 value) {
+	cosimPins.pump2 = value;
+}
+
+
+uint8 Pump2_En_Read(void) {
+	return cosimPins.pump2;
+}
+
+
+void UV_En_Write(uint8 value) {
+	cosimPins.uv = value;
+}
+
+
+void Bubbler_En_Write(uint8 value) {
+	cosimPins.bubbler = value;
+}
+
+
+void LED_Pin_Write(uint8 value) {
+	cosimPins.led = value;
+}
+
+
+uint8 SW1_Pin_Read(void) {
+	return 1; //Pulled up, never pressed
+}
+
+
+void Solenoid_Select_Write(uint8 value) {
+	(void) value; //Recirculation follows toggleRecirculation(), as in the setup shell
+}
+
+
+void Solenoid_Signal_Write(uint8 value) {
+	(void) value;
+}
+
+
+void Timer_Recirculate_Start(void) {
+	recirculateTimer.running = 1;
+}
+
+
+void Timer_Recirculate_Sleep(void) {
+	recirculateTimer.running = 0;
+}
+
+
+void Timer_Recirculate_Wakeup(void) {
+	recirculateTimer.running = 1;
+}
+
+
+void Timer_Recirculate_WriteCounter(uint32 counter) {
+	recirculateTimer.counter = counter;
+}
+
+
+void Timer_Recirculate_WritePeriod(uint32 period) {
+	recirculateTimer.period = period;
+}
+
+
+uint8 Timer_Recirculate_ReadStatusRegister(void) {
+	return 0;
+}
+
+
+void Recirculate_Interrupt_StartEx(cyisraddress address) {
+	recirculateTimer.isr = address;
+}
+
+
+void Timer_Watchdog_Start(void) {
+	watchdogTimer.running = 1;
+}
+
+
+uint8 Timer_Watchdog_ReadStatusRegister(void) {
+	return 0;
+}
+
+
+void Watchdog_Interrupt_StartEx(cyisraddress address) {
+	watchdogTimer.isr = address;
+}
+
+
+void ADC_Pot_Start(void) {}
+
+
+void ADC_Pot_StartConvert(void) {}
+
+
+uint8 ADC_Pot_IsEndConversion(uint8 retMode) {
+	(void) retMode;
+	return 1;
+}
+
+
+int8 ADC_Pot_GetResult8(void) {
+	return (int8) 0xff; //Pots turned all the way up
+}
+
+
+void AMux_Pot_Select(uint8 channel) {
+	(void) channel;
+}
+
+
+void PWM_0_Start(void) {}
+void PWM_1_Start(void) {}
+void PWM_2_Start(void) {}
+void PWM_3_Start(void) {}
+
+
+void PWM_0_WriteCompare(uint8 compare) {
+	pwmCompare[0] = compare;
+}
+
+
+void PWM_1_WriteCompare(uint8 compare) {
+	pwmCompare[1] = compare;
+}
+
+
+void PWM_2_WriteCompare(uint8 compare) {
+	pwmCompare[2] = compare;
+}
+
+
+//––––––––––––––––––––––––––––––  Private Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]	Returns the simulated milliseconds until a timer interrupts, or a very long
+		time if it is stopped or has no ISR.
+*/
+double timerDue(Timer* t) {
+	double remaining;
+	if (!t->running || t->isr == NULL || t->period <= 0) {
+		return 1e300;
+	}
+	remaining = (t->period - t->counter) / t->countsPerMs;
+	return remaining > 0 ? remaining : 0;
+}
+
+
+/*
+[desc]	Counts a timer forward and runs its ISR on reaching the period. The counter
+		reloads first so an ISR that writes it keeps its value. Other interrupts
+		wait while an ISR runs.
+
+[t] The timer.
+[milliseconds] Simulated time that passed, no further than timerDue().
+*/
+void timerRun(Timer* t, double milliseconds) {
+	if (!t->running) {
+		return;
+	}
+	t->counter += milliseconds * t->countsPerMs;
+	if (t->isr != NULL && t->period > 0 && t->counter >= t->period && !inInterrupt) {
+		t->counter = 0;
+		inInterrupt = 1;
+		t->isr();
+		inInterrupt = 0;
+	}
+}
+
+
+/* EOF */
@@ -0,0 +1,192 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	Shims for the firmware's own libraries in the co-simulation. Float switches,
+	sensors and the charge controller read the simulated machine, USB output is
+	dropped, and the setup shell is never entered.
+*/
+
+#include "tank.h"
+#include "ezoProtocol.h"
+#include "pressure.h"
+#include "usbProtocol.h"
+#include "waterlabSetupShell.h"
+#include "tristarProtocol.h"
+#include "cosim.h"
+
+
+//––––––  Private Declarations  ––––––//
+uint8 lastTankStates[MAX_TANK_COUNT];
+TankEventRecord eventQueue[TANK_EVENT_QUEUE_SIZE];
+uint8 queueHead, queueTail;
+uint32 queueOverflows;
+uint32 tankTicks; //Simulated milliseconds since tankInit()
+
+void queueEvent(uint8 tank, uint32 event);
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+void cosimTanksChanged(void) {
+	uint8 state;
+	int i;
+	tankTicks += COSIM_MS_PER_CYCLE;
+	for (i=0; i < MAX_TANK_COUNT; i++) {
+		state = cosimTankState(i);
+		if (state == TANK_STATE_EMPTY && lastTankStates[i] != TANK_STATE_EMPTY) {
+			queueEvent(i, TANK_EVENT_EMPTY(i)); //Lower switch dropped
+		} else if (state == TANK_STATE_FULL && lastTankStates[i] != TANK_STATE_FULL) {
+			queueEvent(i, TANK_EVENT_FULL(i)); //Upper switch floated
+		}
+		lastTankStates[i] = state;
+	}
+}
+
+
+void tankInit(void) {
+	int i;
+	for (i=0; i < MAX_TANK_COUNT; i++) {
+		lastTankStates[i] = cosimTankState(i);
+	}
+	tankEvents = TANK_EVENT_NONE;
+	queueHead = queueTail = 0;
+	queueOverflows = 0;
+	tankTicks = 0;
+}
+
+
+tankStruct tankGetStates(void) {
+	tankStruct tankStates;
+	int i;
+	for (i=0; i < MAX_TANK_COUNT; i++) {
+		tankStates.tank[i] = cosimTankState(i);
+	}
+	return tankStates;
+}
+
+
+uint8 tankEventOccurred(uint32 tankEventFlag) {
+	return ((tankEvents & tankEventFlag) != 0);
+}
+
+
+uint8 tankClearEvent(uint32 tankEventFlag) {
+	uint8 tmp = ((tankEvents & tankEventFlag) != 0);
+	tankEvents &= (~tankEventFlag);
+	return tmp;
+}
+
+
+uint8 tankPollEvent(TankEventRecord* record) {
+	if (queueTail == queueHead) {
+		return 0;
+	}
+	*record = eventQueue[queueTail++ % TANK_EVENT_QUEUE_SIZE];
+	return 1;
+}
+
+
+uint32 tankEventOverflows(void) {
+	return queueOverflows;
+}
+
+
+void ezoStart(void) {}
+
+
+void ezoRun(void) {}
+
+
+void ezoSetProcessActive(uint8 active) {
+	(void) active;
+}
+
+
+double ezoGetData(uint8 slaveAddress) {
+	if (slaveAddress == EC_SENSOR_ADDRESS) {
+		return cosimConductivity();
+	} else if (slaveAddress == DO_SENSOR_ADDRESS) {
+		return cosimDissolvedOxygen();
+	}
+	return 0.0;
+}
+
+
+int32 ezoGetFixed(uint8 slaveAddress, uint8 field) {
+	if (field != 0) {
+		return EZO_NO_READING;
+	}
+	return EZO_FIXED(ezoGetData(slaveAddress));
+}
+
+
+void pressureInit(void) {}
+
+
+double getPressure(uint8 sensorIndex) {
+	(void) sensorIndex;
+	return 0.0;
+}
+
+
+void tstarStart(void) {}
+
+
+void tstarRun(void) {}
+
+
+double tstarBattVolt(void) {
+	return cosimBatteryVolts();
+}
+
+
+double tstarPVCurrent(void) {
+	return cosimPanelAmps();
+}
+
+
+void usbStart(void) {}
+
+
+void usbSendString(char string[]) {
+	(void) string;
+}
+
+
+void usbLog(char logLevel[], char string[]) {
+	(void) logLevel;
+	(void) string;
+}
+
+
+void shellRun(void) {}
+
+
+void toggleRecirculation(void) {
+	cosimPins.recirculate = !cosimPins.recirculate;
+	CyDelay(50); //Length of signal to toggle solenoid
+}
+
+
+//––––––––––––––––––––––––––––––  Private Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]	Raises a tank event the way FSwitch_ISR does, as a bit in tankEvents and a
+		record in the event queue.
+
+[tank] Firmware tank index.
+[event] The TankEventFlag raised.
+*/
+void queueEvent(uint8 tank, uint32 event) {
+	tankEvents |= event;
+	if ((uint8)(queueHead - queueTail) >= TANK_EVENT_QUEUE_SIZE) {
+		queueOverflows++;
+		return;
+	}
+	eventQueue[queueHead % TANK_EVENT_QUEUE_SIZE] = (TankEventRecord) {tankTicks, tank, event};
+	queueHead++;
+}
+
+
+/* EOF */
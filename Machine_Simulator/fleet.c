@@ -0,0 +1,555 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	Struct-of-arrays fleet of machines, advanced with SIMD vectors. Each step
+	of the kernel is a masked, branch-free copy of stepMachine(), updateMachine(),
+	runDevice() and moveWater() in machine.c. Keep the two in sync: the physics
+	is all integer, so every lane matches the scalar simulator bit for bit.
+
+	Tanks carry their fullAt and emptyAt thresholds, and the battery low test is
+	turned into an integer threshold per lane when the fleet is built, so the
+	kernel only compares integers.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "fleet.h"
+
+
+#if defined(__AVX2__)
+	#define FLEET_LANES 8
+#else
+	#define FLEET_LANES 4
+#endif
+
+#define FLEET_PAD 16 //Lanes are padded to a multiple of this so every array is cache line aligned
+#define FLEET_ALIGN 64
+#define FLUSH_CYCLES 4096 //Cycles between flushing 32-bit lane counters into 64-bit totals
+
+#define NUM_TANKS DEFAULT_TANK_COUNT
+#define NUM_DEVICES DEFAULT_DEVICE_COUNT
+#define NUM_INT_ARRAYS (5 * NUM_TANKS + 4 * NUM_DEVICES + 8)
+#define NUM_LONG_ARRAYS 6
+
+
+/* Wiring of defaultMachine(). Constant so the kernel's tank indexes fold away */
+static const int deviceSource[NUM_DEVICES] = {
+	[DEVICE_FILTER_PUMP] = TANK_SOURCE,
+	[DEVICE_RO_PUMP] = TANK_FILTERED,
+	[DEVICE_UV] = TANK_PERMEATE,
+	[DEVICE_DRAIN] = TANK_DISINFECTED,
+	[DEVICE_RO_REJECT] = TANK_FILTERED,
+};
+static const int deviceSink[NUM_DEVICES] = {
+	[DEVICE_FILTER_PUMP] = TANK_FILTERED,
+	[DEVICE_RO_PUMP] = TANK_PERMEATE,
+	[DEVICE_UV] = TANK_DISINFECTED,
+	[DEVICE_DRAIN] = TANK_SINK,
+	[DEVICE_RO_REJECT] = TANK_SINK,
+};
+
+
+//––––––  Private Types  ––––––//
+typedef int32_t vint __attribute__((vector_size(4 * FLEET_LANES)));
+typedef double vdouble __attribute__((vector_size(8 * FLEET_LANES)));
+
+struct Fleet {
+	int count;
+	int lanes; //count rounded up to FLEET_PAD
+	void* arena;
+
+	int32_t* quantity[NUM_TANKS];
+	int32_t* volume[NUM_TANKS];
+	int32_t* fullAt[NUM_TANKS]; //isFull() when quantity >= fullAt
+	int32_t* emptyAt[NUM_TANKS]; //isEmpty() when quantity <= emptyAt
+	int32_t* turbidity[NUM_TANKS];
+	int32_t* flowRate[NUM_DEVICES];
+	int32_t* consumption[NUM_DEVICES];
+	int32_t* newTurbidity[NUM_DEVICES];
+	int32_t* enable[NUM_DEVICES]; //-1 when enabled, 0 otherwise
+	int32_t* remaining;
+	int32_t* batteryMax;
+	int32_t* lowBelow; //Battery is under its lowThreshold when remaining < lowBelow
+	int32_t* recharge;
+	int32_t* infinite; //-1 when infinite energy is on, 0 otherwise
+	int32_t* state;
+	int32_t* daytime; //-1 during the day, 0 at night
+	int32_t* phase; //totalCycles % HALF_DAY
+
+	int64_t* totalCycles;
+	int64_t* deviceCycles;
+	int64_t* idleCycles;
+	int64_t* waterPurified;
+	int64_t* waterRejected;
+	int64_t* energyUsed;
+};
+
+/* One vector of lanes, held in locals while the kernel runs */
+typedef struct LaneGroup {
+	vint quantity[NUM_TANKS];
+	vint volume[NUM_TANKS];
+	vint fullAt[NUM_TANKS];
+	vint emptyAt[NUM_TANKS];
+	vint turbidity[NUM_TANKS];
+	vint flowRate[NUM_DEVICES];
+	vint consumption[NUM_DEVICES];
+	vint newTurbidity[NUM_DEVICES];
+	vint enable[NUM_DEVICES];
+	vint remaining;
+	vint batteryMax;
+	vint lowBelow;
+	vint recharge;
+	vint infinite;
+	vint state;
+	vint daytime;
+	vint phase;
+
+	vint deviceCycles; //Counters since the last flush
+	vint idleCycles;
+	vint waterPurified;
+	vint waterRejected;
+	vint energyUsed;
+} LaneGroup;
+
+typedef struct FleetJob {
+	Fleet* fleet;
+	long cycles;
+} FleetJob;
+
+
+//––––––  Private Declarations  ––––––//
+int wiredLikeDefault(Machine* m);
+void* carve(char** cursor, size_t bytes);
+void fleetJob(void* arg, int index);
+void runLaneGroup(Fleet* f, int base, long cycles);
+
+
+//––––––––––––––––––––––––––––––  Vector Helpers  ––––––––––––––––––––––––––––––//
+
+/* mask ? a : b, where mask lanes are -1 or 0 */
+static inline vint blend(vint mask, vint a, vint b) {
+	return (mask & a) | (~mask & b);
+}
+
+
+static inline vint vmin(vint a, vint b) {
+	return blend(a < b, a, b);
+}
+
+/* Macros rather than functions, so no double vector crosses a call */
+#define todouble(a) __builtin_convertvector((a), vdouble)
+#define toint(a) __builtin_convertvector((a), vint)
+
+static inline int anyLane(vint mask) {
+	int i;
+	for (i=0; i < FLEET_LANES; i++) {
+		if (mask[i]) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static inline vint splat(int32_t x) {
+	return (vint){} + x;
+}
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+Fleet* fleet(Machine* machines[], int count) {
+	Fleet* f;
+	Machine* m;
+	char* cursor;
+	int i, t, d, lane;
+
+	if (count <= 0) {
+		return NULL;
+	}
+	for (i=0; i < count; i++) {
+		if (!wiredLikeDefault(machines[i])) {
+			return NULL;
+		}
+	}
+
+	f = (Fleet*) calloc(1, sizeof(Fleet));
+	f->count = count;
+	f->lanes = (count + FLEET_PAD - 1) / FLEET_PAD * FLEET_PAD;
+	f->arena = aligned_alloc(FLEET_ALIGN, (size_t)f->lanes * (NUM_INT_ARRAYS * 4 + NUM_LONG_ARRAYS * 8));
+	cursor = (char*) f->arena;
+	for (t=0; t < NUM_TANKS; t++) {
+		f->quantity[t] = carve(&cursor, f->lanes * 4);
+		f->volume[t] = carve(&cursor, f->lanes * 4);
+		f->fullAt[t] = carve(&cursor, f->lanes * 4);
+		f->emptyAt[t] = carve(&cursor, f->lanes * 4);
+		f->turbidity[t] = carve(&cursor, f->lanes * 4);
+	}
+	for (d=0; d < NUM_DEVICES; d++) {
+		f->flowRate[d] = carve(&cursor, f->lanes * 4);
+		f->consumption[d] = carve(&cursor, f->lanes * 4);
+		f->newTurbidity[d] = carve(&cursor, f->lanes * 4);
+		f->enable[d] = carve(&cursor, f->lanes * 4);
+	}
+	f->remaining = carve(&cursor, f->lanes * 4);
+	f->batteryMax = carve(&cursor, f->lanes * 4);
+	f->lowBelow = carve(&cursor, f->lanes * 4);
+	f->recharge = carve(&cursor, f->lanes * 4);
+	f->infinite = carve(&cursor, f->lanes * 4);
+	f->state = carve(&cursor, f->lanes * 4);
+	f->daytime = carve(&cursor, f->lanes * 4);
+	f->phase = carve(&cursor, f->lanes * 4);
+	f->totalCycles = carve(&cursor, f->lanes * 8);
+	f->deviceCycles = carve(&cursor, f->lanes * 8);
+	f->idleCycles = carve(&cursor, f->lanes * 8);
+	f->waterPurified = carve(&cursor, f->lanes * 8);
+	f->waterRejected = carve(&cursor, f->lanes * 8);
+	f->energyUsed = carve(&cursor, f->lanes * 8);
+
+	/* Padding lanes are copies of the first machine, their results are never read */
+	for (lane=0; lane < f->lanes; lane++) {
+		m = machines[lane < count ? lane : 0];
+		for (t=0; t < NUM_TANKS; t++) {
+			f->quantity[t][lane] = m->tanks[t]->quantity;
+			f->volume[t][lane] = m->tanks[t]->volume;
+			f->fullAt[t][lane] = m->tanks[t]->fullAt;
+			f->emptyAt[t][lane] = m->tanks[t]->emptyAt;
+			f->turbidity[t][lane] = m->tanks[t]->turbidity;
+		}
+		for (d=0; d < NUM_DEVICES; d++) {
+			f->flowRate[d][lane] = m->devices[d]->flowRate;
+			f->consumption[d][lane] = m->devices[d]->consumption;
+			f->newTurbidity[d][lane] = m->devices[d]->newTurbidity;
+			f->enable[d][lane] = m->devices[d]->enable ? -1 : 0;
+		}
+		f->remaining[lane] = m->mainBattery->remaining;
+		f->batteryMax[lane] = m->mainBattery->max;
+		/* remaining*100 / max < LOW  <=>  remaining < ceil(LOW*max / 100), for remaining >= 0 */
+		f->lowBelow[lane] = (m->mainBattery->lowThreshold * m->mainBattery->max + 99) / 100;
+		f->recharge[lane] = m->rechargePerCycle;
+		f->infinite[lane] = m->infiniteEnergy ? -1 : 0;
+		f->state[lane] = m->machineState;
+		f->daytime[lane] = m->daytime ? -1 : 0;
+		f->phase[lane] = m->totalCycles % HALF_DAY;
+		f->totalCycles[lane] = m->totalCycles;
+		f->deviceCycles[lane] = m->deviceCycles;
+		f->idleCycles[lane] = m->idleCycles;
+		f->waterPurified[lane] = m->waterPurified;
+		f->waterRejected[lane] = m->waterRejected;
+		f->energyUsed[lane] = m->energyUsed;
+	}
+	return f;
+}
+
+
+void runFleet(Fleet* f, long cycles, ThreadPool* pool) {
+	FleetJob job;
+	int group;
+	if (pool) {
+		job.fleet = f;
+		job.cycles = cycles;
+		poolRun(pool, fleetJob, &job, f->lanes / FLEET_LANES);
+	} else {
+		for (group=0; group < f->lanes / FLEET_LANES; group++)
+			runLaneGroup(f, group * FLEET_LANES, cycles);
+	}
+}
+
+
+MachineStats fleetStats(Fleet* f, int index) {
+	MachineStats stats = {};
+	stats.totalCycles = f->totalCycles[index];
+	stats.deviceCycles = f->deviceCycles[index];
+	stats.idleCycles = f->idleCycles[index];
+	stats.waterPurified = f->waterPurified[index];
+	stats.waterRejected = f->waterRejected[index];
+	stats.energyUsed = f->energyUsed[index];
+	stats.batteryRemaining = f->remaining[index];
+	stats.batteryMax = f->batteryMax[index];
+	return stats;
+}
+
+
+void fleetStore(Fleet* f, Machine* machines[]) {
+	Machine* m;
+	int i, t, d;
+	for (i=0; i < f->count; i++) {
+		m = machines[i];
+		for (t=0; t < NUM_TANKS; t++) {
+			m->tanks[t]->quantity = f->quantity[t][i];
+			m->tanks[t]->turbidity = f->turbidity[t][i];
+		}
+		for (d=0; d < NUM_DEVICES; d++) {
+			m->devices[d]->enable = f->enable[d][i] & 1;
+		}
+		m->mainBattery->remaining = f->remaining[i];
+		m->machineState = (MachineStates) f->state[i];
+		m->daytime = f->daytime[i] & 1;
+		m->totalCycles = f->totalCycles[i];
+		m->deviceCycles = f->deviceCycles[i];
+		m->idleCycles = f->idleCycles[i];
+		m->waterPurified = f->waterPurified[i];
+		m->waterRejected = f->waterRejected[i];
+		m->energyUsed = f->energyUsed[i];
+	}
+}
+
+
+int fleetSize(Fleet* f) {
+	return f->count;
+}
+
+
+void freeFleet(Fleet* f) {
+	if (f == NULL) {
+		return;
+	}
+	free(f->arena);
+	free(f);
+}
+
+
+//––––––––––––––––––––––––––––––  Private Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]	Checks that a machine has the tanks and devices of defaultMachine(), wired
+		the same way.
+
+[ret]	1 if the fleet kernel can run the machine, 0 otherwise.
+*/
+int wiredLikeDefault(Machine* m) {
+	int d;
+	if (m->numTanks != NUM_TANKS || m->numDevices != NUM_DEVICES) {
+		return 0;
+	}
+	for (d=0; d < NUM_DEVICES; d++) {
+		if (m->devices[d] == NULL || m->devices[d]->source != m->tanks[deviceSource[d]]
+				|| m->devices[d]->sink != m->tanks[deviceSink[d]]) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+
+/*
+[desc]	Hands out the next block of a fleet's arena and advances the cursor past it.
+*/
+void* carve(char** cursor, size_t bytes) {
+	void* block = *cursor;
+	memset(block, 0, bytes);
+	*cursor += bytes;
+	return block;
+}
+
+
+/*
+[desc]	Pool task for runFleet(). Runs one vector of lanes.
+
+[arg] A FleetJob.
+[index] Index of the lane group.
+*/
+void fleetJob(void* arg, int index) {
+	FleetJob* job = (FleetJob*) arg;
+	runLaneGroup(job->fleet, index * FLEET_LANES, job->cycles);
+}
+
+
+/*
+[desc]	Vector isFull(). Lanes are -1 where the tank is full.
+*/
+static inline vint lanesFull(LaneGroup* g, int t) {
+	return g->quantity[t] >= g->fullAt[t];
+}
+
+
+/*
+[desc]	Vector isEmpty(). Lanes are -1 where the tank is empty.
+*/
+static inline vint lanesEmpty(LaneGroup* g, int t) {
+	return g->quantity[t] <= g->emptyAt[t];
+}
+
+
+/*
+[desc]	Vector deviceAvailable(). Lanes are -1 where device d can run this cycle.
+*/
+static inline vint lanesAvailable(LaneGroup* g, int d) {
+	return ~lanesFull(g, deviceSink[d]) & ~lanesEmpty(g, deviceSource[d])
+		& (g->consumption[d] <= g->remaining);
+}
+
+
+/*
+[desc]	Vector runDevice() and moveWater(). Only lanes set in run are changed.
+
+[ret]	Water moved in each lane, 0 in lanes that did not run.
+*/
+static inline vint runLanes(LaneGroup* g, int d, vint run) {
+	int src = deviceSource[d];
+	int snk = deviceSink[d];
+	vint sourceTurbidity, amount, total, quotient;
+	vdouble mixed, divisor;
+
+	sourceTurbidity = blend((g->newTurbidity[d] < g->turbidity[src]) & (g->newTurbidity[d] >= 0),
+			g->newTurbidity[d], g->turbidity[src]);
+
+	g->remaining -= run & ~g->infinite & (g->remaining >= g->consumption[d]) & g->consumption[d];
+	g->energyUsed += run & g->consumption[d]; //Counted with infinite energy too, as runDevice() does
+
+	/* set new turbidity for sink using weighted average, before clipping the amount */
+	amount = g->flowRate[d];
+	if (anyLane(run)) { //Skip the divide when no lane runs, which is common
+		total = g->quantity[snk] + amount;
+		divisor = todouble(total + ((total <= 0) & 1)); //Lanes where total is 0 keep their turbidity
+		mixed = todouble(sourceTurbidity)*todouble(amount) + todouble(g->turbidity[snk])*todouble(g->quantity[snk])
+			+ todouble(total/2);
+
+		/* There is no vector integer divide. Every term is an integer well under 2^53, so
+		   the doubles are exact, and the rounding error of the quotient is below 1/divisor,
+		   too small to carry it across an integer. Truncating it divides exactly. */
+		quotient = toint(mixed / divisor);
+		g->turbidity[snk] = blend(run & (total > 0), quotient, g->turbidity[snk]);
+	}
+
+	amount = vmin(amount, g->quantity[src]); //Source doesnt have enough
+	amount = blend(amount + g->quantity[snk] > g->volume[snk], g->volume[snk] - g->quantity[snk], amount);
+
+	g->quantity[src] -= run & (g->quantity[src] != INFINITE_VOLUME) & amount;
+	g->quantity[snk] += run & (g->volume[snk] != INFINITE_VOLUME) & amount;
+	return run & amount;
+}
+
+
+/*
+[desc]	Vector stepMachine(). Every lane takes exactly the path updateMachine() would
+		take for that machine, selected with masks instead of branches.
+*/
+static inline void stepLanes(LaneGroup* g) {
+	vint low, availFilter, availRO, availUV;
+	vint idle, runFilter, runRO, runUV, stopFilter, stopRO, stopUV;
+	vint toIdle, toFilter, toRO, toUV;
+
+	g->remaining += g->daytime & g->recharge; //recharge if its daytime
+	g->remaining = vmin(g->remaining, g->batteryMax);
+
+	low = g->remaining < g->lowBelow;
+	availFilter = lanesAvailable(g, DEVICE_FILTER_PUMP);
+	availRO = lanesAvailable(g, DEVICE_RO_PUMP);
+	availUV = lanesAvailable(g, DEVICE_UV);
+
+	idle = g->state == STATE_IDLE;
+	runFilter = (g->state == STATE_RUN_FILTER_PUMP) & availFilter;
+	runRO = (g->state == STATE_RUN_RO_PUMP) & availRO;
+	runUV = (g->state == STATE_RUN_UV) & availUV;
+	stopFilter = (g->state == STATE_RUN_FILTER_PUMP) & ~availFilter;
+	stopRO = (g->state == STATE_RUN_RO_PUMP) & ~availRO;
+	stopUV = (g->state == STATE_RUN_UV) & ~availUV;
+
+	/* State transitions, in the priority order of updateMachine() */
+	toIdle = (stopFilter | stopRO | stopUV) & low;
+	toFilter = (idle | stopRO | stopUV) & ~low & availFilter;
+	toRO = ((idle | stopUV) & ~low & ~availFilter & availRO) | (stopFilter & ~low & availRO);
+	toUV = (idle & ~low & ~availFilter & ~availRO & availUV) | (stopFilter & ~low & ~availRO & availUV)
+		| (stopRO & ~low & ~availFilter & availUV);
+
+	g->idleCycles -= idle & low;
+	g->enable[DEVICE_FILTER_PUMP] = (g->enable[DEVICE_FILTER_PUMP] & ~stopFilter) | toFilter;
+	g->enable[DEVICE_RO_PUMP] = (g->enable[DEVICE_RO_PUMP] & ~stopRO) | toRO;
+	g->enable[DEVICE_RO_REJECT] = (g->enable[DEVICE_RO_REJECT] & ~stopRO) | toRO;
+	g->enable[DEVICE_UV] = (g->enable[DEVICE_UV] & ~stopUV) | toUV;
+	g->state = blend(toIdle, splat(STATE_IDLE), g->state);
+	g->state = blend(toFilter, splat(STATE_RUN_FILTER_PUMP), g->state);
+	g->state = blend(toRO, splat(STATE_RUN_RO_PUMP), g->state);
+	g->state = blend(toUV, splat(STATE_RUN_UV), g->state);
+
+	/* A lane runs at most one stage per cycle, so the masked runs never overlap */
+	runLanes(g, DEVICE_FILTER_PUMP, runFilter);
+	runLanes(g, DEVICE_RO_PUMP, runRO);
+	g->waterRejected += runLanes(g, DEVICE_RO_REJECT, runRO);
+	g->waterRejected += runLanes(g, DEVICE_RO_REJECT, runRO);
+	g->waterPurified += runLanes(g, DEVICE_UV, runUV);
+	g->deviceCycles -= runFilter | runRO | runUV;
+
+	runLanes(g, DEVICE_DRAIN, lanesAvailable(g, DEVICE_DRAIN));
+
+	g->daytime ^= g->phase == 0; // invert daytime every half day
+	g->phase += 1;
+	g->phase = blend(g->phase == HALF_DAY, splat(0), g->phase);
+}
+
+
+/*
+[desc]	Runs one vector of lanes for a number of cycles. The lanes are copied into a
+		LaneGroup for the whole run, and the group's 32-bit counters are flushed into
+		the fleet's 64-bit totals every FLUSH_CYCLES.
+
+[f] The fleet.
+[base] First lane of the group.
+[cycles] Number of state-machine cycles to run.
+*/
+void runLaneGroup(Fleet* f, int base, long cycles) {
+	LaneGroup g;
+	long done, chunk, i;
+	int t, d, lane;
+
+	for (t=0; t < NUM_TANKS; t++) {
+		memcpy(&g.quantity[t], &f->quantity[t][base], sizeof(vint));
+		memcpy(&g.volume[t], &f->volume[t][base], sizeof(vint));
+		memcpy(&g.fullAt[t], &f->fullAt[t][base], sizeof(vint));
+		memcpy(&g.emptyAt[t], &f->emptyAt[t][base], sizeof(vint));
+		memcpy(&g.turbidity[t], &f->turbidity[t][base], sizeof(vint));
+	}
+	for (d=0; d < NUM_DEVICES; d++) {
+		memcpy(&g.flowRate[d], &f->flowRate[d][base], sizeof(vint));
+		memcpy(&g.consumption[d], &f->consumption[d][base], sizeof(vint));
+		memcpy(&g.newTurbidity[d], &f->newTurbidity[d][base], sizeof(vint));
+		memcpy(&g.enable[d], &f->enable[d][base], sizeof(vint));
+	}
+	memcpy(&g.remaining, &f->remaining[base], sizeof(vint));
+	memcpy(&g.batteryMax, &f->batteryMax[base], sizeof(vint));
+	memcpy(&g.lowBelow, &f->lowBelow[base], sizeof(vint));
+	memcpy(&g.recharge, &f->recharge[base], sizeof(vint));
+	memcpy(&g.infinite, &f->infinite[base], sizeof(vint));
+	memcpy(&g.state, &f->state[base], sizeof(vint));
+	memcpy(&g.daytime, &f->daytime[base], sizeof(vint));
+	memcpy(&g.phase, &f->phase[base], sizeof(vint));
+
+	for (done=0; done < cycles; done += chunk) {
+		chunk = cycles - done < FLUSH_CYCLES ? cycles - done : FLUSH_CYCLES;
+		g.deviceCycles = splat(0);
+		g.idleCycles = splat(0);
+		g.waterPurified = splat(0);
+		g.waterRejected = splat(0);
+		g.energyUsed = splat(0);
+		for (i=0; i < chunk; i++) {
+			stepLanes(&g);
+		}
+		for (lane=0; lane < FLEET_LANES; lane++) {
+			f->deviceCycles[base + lane] += g.deviceCycles[lane];
+			f->idleCycles[base + lane] += g.idleCycles[lane];
+			f->waterPurified[base + lane] += g.waterPurified[lane];
+			f->waterRejected[base + lane] += g.waterRejected[lane];
+			f->energyUsed[base + lane] += g.energyUsed[lane];
+		}
+	}
+
+	for (t=0; t < NUM_TANKS; t++) {
+		memcpy(&f->quantity[t][base], &g.quantity[t], sizeof(vint));
+		memcpy(&f->turbidity[t][base], &g.turbidity[t], sizeof(vint));
+	}
+	for (d=0; d < NUM_DEVICES; d++) {
+		memcpy(&f->enable[d][base], &g.enable[d], sizeof(vint));
+	}
+	memcpy(&f->remaining[base], &g.remaining, sizeof(vint));
+	memcpy(&f->state[base], &g.state, sizeof(vint));
+	memcpy(&f->daytime[base], &g.daytime, sizeof(vint));
+	memcpy(&f->phase[base], &g.phase, sizeof(vint));
+	for (lane=0; lane < FLEET_LANES; lane++) {
+		f->totalCycles[base + lane] += cycles;
+	}
+}
+
+
+/* EOF */
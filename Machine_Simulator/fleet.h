@@ -0,0 +1,79 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	Fleet mode for the machine simulator. A fleet holds many machines that share
+	the default machine's layout of tanks and devices, stored as struct-of-arrays:
+	every tank quantity for one tank is contiguous, every turbidity is contiguous,
+	and so on. The fleet kernel advances several machines at once with SIMD
+	vectors, one machine per lane, and gives the same results as running each
+	machine with runMachineHeadless().
+
+	The kernel is written with GCC vector extensions, so it compiles to SSE2 on
+	any x86-64 build and to 8-lane AVX2 when built with -mavx2.
+*/
+
+#ifndef FLEET_H
+#define FLEET_H
+
+#include "machine.h"
+#include "threadPool.h"
+
+
+typedef struct Fleet Fleet;
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]	Constructor for a Fleet. Copies the state of every machine into the fleet's
+		arrays. The machines are not modified and may be freed afterwards. Every
+		machine must be wired like defaultMachine(), though volumes, flow rates,
+		consumption, turbidities, battery and recharge may differ.
+
+[machines] Array of machines to copy.
+[count] Number of machines.
+
+[ret]	A pointer to the new fleet, or NULL if a machine is not wired like the
+		default machine.
+*/
+Fleet* fleet(Machine* machines[], int count);
+
+/*
+[desc]	Runs every machine in the fleet for a number of state-machine cycles.
+
+[f] The fleet to run.
+[cycles] Number of state-machine cycles to run each machine for.
+[pool] Thread pool to spread groups of lanes across, or NULL to run on this thread.
+*/
+void runFleet(Fleet* f, long cycles, ThreadPool* pool);
+
+/*
+[desc]	Returns the running statistics of one machine in the fleet.
+
+[f] The fleet to examine.
+[index] Index of the machine, in the order given to fleet().
+*/
+MachineStats fleetStats(Fleet* f, int index);
+
+/*
+[desc]	Copies the state of the fleet back into machines, for example to print or
+		keep running them one at a time.
+
+[f] The fleet to copy from.
+[machines] Machines in the order given to fleet(). Must be wired the same way.
+*/
+void fleetStore(Fleet* f, Machine* machines[]);
+
+/*
+[desc]	Returns the number of machines in a fleet.
+*/
+int fleetSize(Fleet* f);
+
+/*
+[desc]	Frees a fleet. May be NULL.
+*/
+void freeFleet(Fleet* f);
+
+
+#endif //FLEET_H
@@ -5,196 +5,361 @@
 	Library to simulate a machine with flowing water moving between tanks.
 	Devices move the water from one tank to the next. Currently this is a
 	non-abstracted library, meaning you should change the source to modify
-	the operation of the defaultMachineInit() and runMachine state-machine.
+	the operation of the defaultMachine() and runMachine state-machine.
 */
 
-#include <time.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include "machine.h"
+#include "render.h"
+#include "trace.h"
+#include "weather.h"
 
 
 #define TRUE 1
 #define FALSE 0
-#define INFINITY 999999
+#define INFINITY INFINITE_VOLUME
 
-#define TANK_FULL_THRESHOLD 90
-#define TANK_LOW_THRESHOLD 5
-#define BATTERY_FULL_THRESHOLD 90
-#define BATTERY_LOW_THRESHOLD 20 //Percentage of energy at which the machine waits to recharge
 #define DEFAULT_BATTERY_SIZE 1000
 #define RECHARGE_PER_CYCLE 10
-#define CYCLES_PER_DAY 24 // hours/day
-#define HALF_DAY (CYCLES_PER_DAY / 2)
+
+#define STATE_KEY_SIZE (2*MAX_TANK_COUNT + MAX_DEVICE_COUNT + 3)
+
+#define RENDER_ROWS 24
+#define RENDER_COLS 80
+#define FRAMES_PER_SECOND 30
 
 #define TANK_PRINT_WIDTH 4
 #define TANK_PRINT_HEIGHT 11
-#define MAX_DEVICE_COUNT 10
-#define MAX_TANK_COUNT MAX_DEVICE_COUNT
 #define SPACING 3
 
 
 //––––––  Private Types  ––––––//
-typedef struct Tank {
-	int volume;
-	int quantity;
-	float turbidity;
-} Tank;
-
-typedef struct Device {
-	int enable;
-	int flowRate;
-	int consumption;
-	float newTurbidity;
-	Tank* source;
-	Tank* sink;
-} Device;
-
-typedef struct Battery {
-	int remaining;
-	int max;
-} Battery;
-
-enum STATES {
-	STATE_IDLE,
-	STATE_RUN_FILTER_PUMP,
-	STATE_RUN_RO_PUMP,
-	STATE_RUN_UV,
-} machineState;
-
-
-//––––––  Private Variables  ––––––//
-Device* devices[MAX_TANK_COUNT] = {};
-int numDevices;
-Tank* tanks[MAX_TANK_COUNT] = {};
-int numTanks;
-Battery* mainBattery;
-int infiniteEnergy;
-int totalCycles;
-int deviceCycles;
-int idleCycles;
-int daytime;
-int waterPurified;
-int waterRejected;
-
+typedef struct RunJob {
+	Machine** machines;
+	long cycles;
+} RunJob;
 
 
 //––––––  Private Declarations  ––––––//
-Tank* tank(int volume, int quantity, float turbidity);
-Device* device(int enable, int flowRate, int consumption, float newTurbidity, Tank* source, Tank* sink);
+Tank* tank(int volume, int quantity, int turbidity);
+Device* device(int enable, int flowRate, int consumption, int newTurbidity, Tank* source, Tank* sink);
 Battery* battery(int remaining, int max);
-void updateMachine(void);
-int moveWater(Tank* source, Tank* sink, int amount, float sourceTurbidity);
-int runDevice(Device* device);
-void printTanks(Tank* tankArr[MAX_TANK_COUNT]);
+Machine* machine(Tank* tankArr[MAX_TANK_COUNT], Device* deviceArr[MAX_DEVICE_COUNT], int batterySize);
+void runJob(void* arg, int index);
+void advanceMachine(Machine* m, long cycles);
+long advanceToEvent(Machine* m, long cycles);
+void stateKey(Machine* m, int key[STATE_KEY_SIZE]);
+int batteryEvent(Machine* m, Device* device, int* event);
+void updateMachine(Machine* m);
+void rechargeBattery(Machine* m);
+int drainBattery(Machine* m, int consumption);
+int moveWater(Tank* source, Tank* sink, int amount, int sourceTurbidity);
+int runDevice(Machine* m, Device* device);
+void printTanks(Renderer* r, Tank* tankArr[MAX_TANK_COUNT]);
 void stageTank(char tankStage[][TANK_PRINT_WIDTH], Tank* tank);
-void printTurbidities(Tank* tank[MAX_TANK_COUNT]);
-void printBattery(Battery* battery);
-void printGraphics(void);
-void printDebug(void);
-void printStats(void);
-int deviceAvailable(Device* device);
-int isFull(Tank* tank);
-int isEmpty(Tank* tank);
-void delay(double dly);
+void printTurbidities(Renderer* r, Tank* tank[MAX_TANK_COUNT]);
+void printBattery(Renderer* r, Machine* m);
+void printDebug(Renderer* r, Machine* m);
+void printStats(Machine* m);
+int deviceAvailable(Machine* m, Device* device);
 
 
 //––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
 
-void runMachine(int cycles, float timePerCycle, int graphicsEnable) {
-	int i, j=0;
-	int tmpCycles = deviceCycles + idleCycles;
-	while(deviceCycles + idleCycles < cycles + tmpCycles) { //Run the machine for <cycles> device on cycles 
-		mainBattery->remaining += daytime ? RECHARGE_PER_CYCLE : 0; //recharge if its daytime
-		if (mainBattery->remaining > mainBattery->max) { //cap refilling at battery max
-			mainBattery->remaining = mainBattery->max; 
+void runMachine(Machine* m, int cycles, float timePerCycle, int graphicsEnable) {
+	Renderer* r = renderer(RENDER_ROWS, RENDER_COLS, FRAMES_PER_SECOND);
+	long tmpCycles = m->deviceCycles + m->idleCycles;
+	while(m->deviceCycles + m->idleCycles < cycles + tmpCycles) { //Run the machine for <cycles> device on cycles 
+		if (!graphicsEnable && advanceToEvent(m, cycles + tmpCycles - m->deviceCycles - m->idleCycles)) {
+			continue;
 		}
-		
-		updateMachine(); // run the state machine
-		if(graphicsEnable) {
-			printGraphics();
-			delay(timePerCycle); //Waste time so the user can watch the tanks change graphically
-		}
-		if (totalCycles++ % HALF_DAY == 0) { // invert daytime every half day
-			daytime = daytime ? FALSE : TRUE;  
+		stepMachine(m);
+		if (graphicsEnable) {
+			renderPace(r, timePerCycle); //Sleep so the user can watch the tanks change graphically
+			if (renderDue(r)) { //Skip frames when cycles are faster than the display
+				printGraphics(r, m);
+				renderFrame(r);
+			}
 		}
 	}
 	/* Print the final state even with graphics disabled */
-	printGraphics();
+	printGraphics(r, m);
+	renderFrame(r);
+	renderEnd(r);
+	freeRenderer(r);
 	printf("\n----- Done -----\n\r");
 	printf("Ran %d cycles\n\n\r" , cycles);
-	printStats();
+	printStats(m);
 }
 
-/*
-[desc]	Initializes a machine described in two storage arrays. Not yet public
-		due to the low-modularity of machine implementation.
 
-[tankArr] Array containing Tank objects, size must be MAX_TANK_COUNT
-[deviceArr]	Array containing Device objects, size must be MAX_TANK_COUNT	
-[batterySize] Size of the battery for the machine		   
-*/
-void machineInit(Tank* tankArr[MAX_TANK_COUNT], Device* deviceArr[MAX_TANK_COUNT], int batterySize) {
-	int i;
-	for (i=0; i < MAX_TANK_COUNT; i++) //Copy to global
-		tanks[i] = tankArr[i];
-	for (i=0; i < MAX_TANK_COUNT; i++)
-		devices[i] = deviceArr[i];
+void runMachineHeadless(Machine* m, long cycles) {
+	int saved[STATE_KEY_SIZE], key[STATE_KEY_SIZE];
+	MachineStats start, now;
+	long power = 1, days = 0, periods, run;
+
+	/* Sample the machine at the start of each day, when daytime is in the same phase */
+	run = (CYCLES_PER_DAY - m->totalCycles % CYCLES_PER_DAY) % CYCLES_PER_DAY;
+	run = run < cycles ? run : cycles;
+	advanceMachine(m, run);
+	cycles -= run;
+
+	/* Brent's cycle detection on the day-to-day state. Once the machine is back in a
+	   state it has been in before, every following period repeats exactly. */
+	stateKey(m, saved);
+	start = machineStats(m);
+	while (m->trace == NULL && m->weather == NULL && cycles >= CYCLES_PER_DAY) { //Traces and weather need every cycle
+		advanceMachine(m, CYCLES_PER_DAY);
+		cycles -= CYCLES_PER_DAY;
+		days++;
+		stateKey(m, key);
+		if (memcmp(key, saved, sizeof(key)) == 0) {
+			periods = cycles / (days * CYCLES_PER_DAY);
+			now = machineStats(m);
+			m->deviceCycles += periods * (now.deviceCycles - start.deviceCycles);
+			m->idleCycles += periods * (now.idleCycles - start.idleCycles);
+			m->waterPurified += periods * (now.waterPurified - start.waterPurified);
+			m->waterRejected += periods * (now.waterRejected - start.waterRejected);
+			m->energyUsed += periods * (now.energyUsed - start.energyUsed);
+			m->totalCycles += periods * days * CYCLES_PER_DAY;
+			cycles -= periods * days * CYCLES_PER_DAY;
+			break;
+		}
+		if (days == power) {
+			memcpy(saved, key, sizeof(key));
+			start = machineStats(m);
+			power *= 2;
+			days = 0;
+		}
+	}
+	advanceMachine(m, cycles);
+}
 
-	for (i=0; tanks[i] != NULL; i++); //Counts for bookeeping
-	numTanks = i;
-	for (i=0; devices[i] != NULL; i++);
-	numDevices = i;
-	machineState = STATE_IDLE;
-	infiniteEnergy = FALSE;
 
-	mainBattery = battery(batterySize, batterySize);
-	totalCycles = 0;
-	deviceCycles = 0;
-	idleCycles = 0;
-	daytime = FALSE;
-	waterPurified = 0;
-	waterRejected = 0;
+void stepDevices(Machine* m) {
+	Device* d;
+	int i, moved, ran = FALSE;
+
+	rechargeBattery(m);
+
+	for (i=0; i < m->numDevices; i++) {
+		d = m->devices[i];
+		if (d == NULL || !d->enable || (!m->infiniteEnergy && d->consumption > m->mainBattery->remaining)) {
+			continue;
+		}
+		moved = runDevice(m, d);
+		if (i == DEVICE_UV && d->source != d->sink) { //Not when recirculating through itself
+			m->waterPurified += moved;
+		} else if (i == DEVICE_RO_REJECT) {
+			m->waterRejected += moved;
+		}
+		ran = ran || d->consumption > 0;
+	}
+	if (ran) {
+		m->deviceCycles++;
+	} else {
+		m->idleCycles++;
+	}
+
+	if (m->totalCycles++ % HALF_DAY == 0) { // invert daytime every half day
+		m->daytime = m->daytime ? FALSE : TRUE;
+	}
+	if (m->trace) {
+		traceRecord(m->trace, m);
+	}
+}
+
+
+void stepMachine(Machine* m) {
+	rechargeBattery(m);
+	
+	updateMachine(m); // run the state machine
+	if (m->totalCycles++ % HALF_DAY == 0) { // invert daytime every half day
+		m->daytime = m->daytime ? FALSE : TRUE;  
+	}
+	if (m->trace) {
+		traceRecord(m->trace, m);
+	}
 }
 
 
-void defaultMachineInit(void) {
+void runMachinesParallel(ThreadPool* pool, Machine* machines[], int count, long cycles) {
+	RunJob job;
+	job.machines = machines;
+	job.cycles = cycles;
+	poolRun(pool, runJob, &job, count);
+}
+
+
+MachineStats machineStats(Machine* m) {
+	MachineStats stats;
+	stats.totalCycles = m->totalCycles;
+	stats.deviceCycles = m->deviceCycles;
+	stats.idleCycles = m->idleCycles;
+	stats.waterPurified = m->waterPurified;
+	stats.waterRejected = m->waterRejected;
+	stats.energyUsed = m->energyUsed;
+	stats.batteryRemaining = m->mainBattery->remaining;
+	stats.batteryMax = m->mainBattery->max;
+	return stats;
+}
+
+
+Machine* defaultMachine(void) {
 	//Initialized outside of array for readable device initialization
 	/* tank(volume, quantity, turbidity) */
-	Tank* source = tank(INFINITY, INFINITY, 5.0);
-	Tank* tank2 = tank(25, 0, 0.0);
-	Tank* tank3 = tank(25, 0, 0.0);
-	Tank* tank4 = tank(25, 0, 0.0);
-	Tank* sink = tank(INFINITY, 0, 0.0);
+	Tank* source = tank(INFINITY, INFINITY, TURBIDITY(5.0));
+	Tank* tank2 = tank(25, 0, 0);
+	Tank* tank3 = tank(25, 0, 0);
+	Tank* tank4 = tank(25, 0, 0);
+	Tank* sink = tank(INFINITY, 0, 0);
 
 	Tank* tankArr[MAX_TANK_COUNT] = {};
-	tankArr[0] = source;
-	tankArr[1] = tank2;
-	tankArr[2] = tank3;
-	tankArr[3] = tank4;
-	tankArr[4] = sink;
+	tankArr[TANK_SOURCE] = source;
+	tankArr[TANK_FILTERED] = tank2;
+	tankArr[TANK_PERMEATE] = tank3;
+	tankArr[TANK_DISINFECTED] = tank4;
+	tankArr[TANK_SINK] = sink;
 
-	Device* deviceArr[MAX_TANK_COUNT] = {};
+	Device* deviceArr[MAX_DEVICE_COUNT] = {};
 	/* device(enable, flowRate, powerconsumption, newTurbidity, source, sink) */
 	//Filter pump
-	deviceArr[0] = device(FALSE, 30, 10, 3.0, source, tank2);
+	deviceArr[DEVICE_FILTER_PUMP] = device(FALSE, 30, 10, TURBIDITY(3.0), source, tank2);
 	//RO pump
-	deviceArr[1] = device(FALSE, 8, 10, 0.3, tank2, tank3);
-	deviceArr[4] = device(FALSE, 16, 0, -1, tank2, sink); //RO reject water
+	deviceArr[DEVICE_RO_PUMP] = device(FALSE, 8, 10, TURBIDITY(0.3), tank2, tank3);
+	deviceArr[DEVICE_RO_REJECT] = device(FALSE, 16, 0, -1, tank2, sink); //RO reject water
 	//UV disinfect
-	deviceArr[2] = device(FALSE, 60, 30, -1, tank3, tank4);
+	deviceArr[DEVICE_UV] = device(FALSE, 60, 30, -1, tank3, tank4);
 	//Slow drain
-	deviceArr[3] = device(FALSE, 10, 0, -1, tank4, sink);
+	deviceArr[DEVICE_DRAIN] = device(FALSE, 10, 0, -1, tank4, sink);
 	
-	machineInit(tankArr, deviceArr, DEFAULT_BATTERY_SIZE); //Load tanks and devices into global arrays
-	printf(""); //Very nasty fix to make the terminal keep up with constant printing.rer
+	return machine(tankArr, deviceArr, DEFAULT_BATTERY_SIZE);
 }
 
 
-int togglePower(void) {
-	mainBattery->remaining = mainBattery->max;
-	infiniteEnergy = infiniteEnergy ? FALSE : TRUE;
-	return infiniteEnergy;
+void freeMachine(Machine* m) {
+	int i;
+	if (m == NULL) {
+		return;
+	}
+	for (i=0; i < m->numTanks; i++)
+		free(m->tanks[i]);
+	for (i=0; i < m->numDevices; i++)
+		free(m->devices[i]);
+	free(m->mainBattery);
+	free(m);
+}
+
+
+void snapshotMachine(Machine* m, MachineSnapshot* snapshot) {
+	DeviceSnapshot* d;
+	int i, t;
+	memset(snapshot, 0, sizeof(MachineSnapshot));
+	for (i=0; i < m->numTanks; i++) {
+		snapshot->tanks[i] = *m->tanks[i];
+	}
+	snapshot->numTanks = m->numTanks;
+	for (i=0; i < m->numDevices; i++) {
+		if (m->devices[i] == NULL) {
+			continue;
+		}
+		d = &snapshot->devices[i];
+		d->present = TRUE;
+		d->enable = m->devices[i]->enable;
+		d->flowRate = m->devices[i]->flowRate;
+		d->consumption = m->devices[i]->consumption;
+		d->newTurbidity = m->devices[i]->newTurbidity;
+		for (t=0; t < m->numTanks; t++) { //Pointers become tank indexes
+			if (m->tanks[t] == m->devices[i]->source)
+				d->source = t;
+			if (m->tanks[t] == m->devices[i]->sink)
+				d->sink = t;
+		}
+	}
+	snapshot->numDevices = m->numDevices;
+	snapshot->mainBattery = *m->mainBattery;
+	snapshot->rechargePerCycle = m->rechargePerCycle;
+	snapshot->machineState = m->machineState;
+	snapshot->infiniteEnergy = m->infiniteEnergy;
+	snapshot->daytime = m->daytime;
+	snapshot->totalCycles = m->totalCycles;
+	snapshot->deviceCycles = m->deviceCycles;
+	snapshot->idleCycles = m->idleCycles;
+	snapshot->waterPurified = m->waterPurified;
+	snapshot->waterRejected = m->waterRejected;
+	snapshot->energyUsed = m->energyUsed;
+}
+
+
+Machine* restoreMachine(const MachineSnapshot* snapshot) {
+	Tank* tankArr[MAX_TANK_COUNT] = {};
+	Device* deviceArr[MAX_DEVICE_COUNT] = {};
+	const DeviceSnapshot* d;
+	Machine* m;
+	int i;
+
+	for (i=0; i < snapshot->numTanks; i++) {
+		tankArr[i] = tank(snapshot->tanks[i].volume, snapshot->tanks[i].quantity, snapshot->tanks[i].turbidity);
+		tankArr[i]->fullThreshold = snapshot->tanks[i].fullThreshold;
+		tankArr[i]->lowThreshold = snapshot->tanks[i].lowThreshold;
+		tankThresholds(tankArr[i]);
+	}
+	for (i=0; i < snapshot->numDevices; i++) {
+		d = &snapshot->devices[i];
+		if (d->present) {
+			deviceArr[i] = device(d->enable, d->flowRate, d->consumption, d->newTurbidity,
+					tankArr[d->source], tankArr[d->sink]);
+		}
+	}
+	m = machine(tankArr, deviceArr, snapshot->mainBattery.max);
+	m->mainBattery->remaining = snapshot->mainBattery.remaining;
+	m->mainBattery->lowThreshold = snapshot->mainBattery.lowThreshold;
+	m->rechargePerCycle = snapshot->rechargePerCycle;
+	m->machineState = snapshot->machineState;
+	m->infiniteEnergy = snapshot->infiniteEnergy;
+	m->daytime = snapshot->daytime;
+	m->totalCycles = snapshot->totalCycles;
+	m->deviceCycles = snapshot->deviceCycles;
+	m->idleCycles = snapshot->idleCycles;
+	m->waterPurified = snapshot->waterPurified;
+	m->waterRejected = snapshot->waterRejected;
+	m->energyUsed = snapshot->energyUsed;
+	return m;
+}
+
+
+int togglePower(Machine* m) {
+	m->mainBattery->remaining = m->mainBattery->max;
+	m->infiniteEnergy = m->infiniteEnergy ? FALSE : TRUE;
+	return m->infiniteEnergy;
+}
+
+
+void printGraphics(Renderer* r, Machine* m) {
+	printTanks(r, m->tanks);
+	printTurbidities(r, m->tanks);
+	printBattery(r, m);
+	// printDebug(r, m);
+}
+
+
+void tankThresholds(Tank* tank) {
+	long long volume = tank->volume;
+	tank->fullAt = (int)((tank->fullThreshold * volume + 99) / 100); //qty*100 >= full*volume
+	tank->emptyAt = (int)(tank->lowThreshold * volume / 100); //qty*100 <= low*volume
+}
+
+
+int isFull(Tank* tank) {
+	return (tank->quantity >= tank->fullAt)? TRUE: FALSE;
+}
+
+
+int isEmpty(Tank* tank) {
+	return (tank->quantity <= tank->emptyAt)? TRUE: FALSE;
 }
 
 
@@ -207,15 +372,18 @@ int togglePower(void) {
 
 [volume] Int representing the maximum capacity of the tank.
 [quantity] Int representing how much water is currently in the tank.
-[turbidity] Float representing the tank's turbidity.
+[turbidity] Fixed-point turbidity of the tank's water, see TURBIDITY().
 
 [ret]	A pointer to the newly created tank object.	   
 */
-Tank* tank(int volume, int quantity, float turbidity) {
+Tank* tank(int volume, int quantity, int turbidity) {
     Tank* t = (Tank*) malloc(sizeof(Tank));
     t->turbidity = turbidity;
     t->volume = volume;
     t->quantity = quantity;
+    t->fullThreshold = TANK_FULL_THRESHOLD;
+    t->lowThreshold = TANK_LOW_THRESHOLD;
+    tankThresholds(t);
 	return t;
 }
 
@@ -226,13 +394,14 @@ Tank* tank(int volume, int quantity, float turbidity) {
 [enable] Decides whether or not the device moves water each cycle.
 [flowRate] Water to be moved by the device per cycle if enable = 1.
 [consumpion] Power consumed by the device (not yet implemented).
-[newTurbidity] Maximum turbidity of water flowing out of this device.
+[newTurbidity] Maximum fixed-point turbidity of water flowing out of this device,
+				or negative to leave it unchanged.
 [source] Tank to source from.
 [sink] Tank to sink into.
 
 [ret]	A pointer to the newly created device object.	   
 */
-Device* device(int enable, int flowRate, int consumption, float newTurbidity, Tank* source, Tank* sink) {
+Device* device(int enable, int flowRate, int consumption, int newTurbidity, Tank* source, Tank* sink) {
 	Device* d = (Device*) malloc(sizeof(Device));
 	d->enable = enable;
 	d->flowRate = flowRate;
@@ -255,128 +424,343 @@ Battery* battery(int remaining, int max) {
     Battery* b = (Battery*) malloc(sizeof(Battery));
     b->remaining = remaining;
     b->max = max;
+    b->lowThreshold = BATTERY_LOW_THRESHOLD;
 	return b;
 }
 
 
+/*
+[desc]	Constructor for a Machine object. Takes ownership of the tanks and devices
+		described in two storage arrays. Not yet public due to the low-modularity
+		of machine implementation.
+
+[tankArr] Array containing Tank objects, size must be MAX_TANK_COUNT
+[deviceArr]	Array containing Device objects, size must be MAX_DEVICE_COUNT	
+[batterySize] Size of the battery for the machine		   
+
+[ret]	A pointer to the newly created machine object.
+*/
+Machine* machine(Tank* tankArr[MAX_TANK_COUNT], Device* deviceArr[MAX_DEVICE_COUNT], int batterySize) {
+	Machine* m = (Machine*) malloc(sizeof(Machine));
+	int i;
+	for (i=0; i < MAX_TANK_COUNT; i++)
+		m->tanks[i] = tankArr[i];
+	for (i=0; i < MAX_DEVICE_COUNT; i++)
+		m->devices[i] = deviceArr[i];
+
+	/* Devices may be sparse in deviceArr, so count up to the last one */
+	for (i=0; i < MAX_TANK_COUNT && m->tanks[i] != NULL; i++); //Counts for bookeeping
+	m->numTanks = i;
+	for (i=MAX_DEVICE_COUNT; i > 0 && m->devices[i - 1] == NULL; i--);
+	m->numDevices = i;
+	m->machineState = STATE_IDLE;
+	m->infiniteEnergy = FALSE;
+
+	m->mainBattery = battery(batterySize, batterySize);
+	m->rechargePerCycle = RECHARGE_PER_CYCLE;
+	m->totalCycles = 0;
+	m->deviceCycles = 0;
+	m->idleCycles = 0;
+	m->daytime = FALSE;
+	m->waterPurified = 0;
+	m->waterRejected = 0;
+	m->energyUsed = 0;
+	m->trace = NULL;
+	m->weather = NULL;
+	return m;
+}
+
+
+/*
+[desc]	Pool task for runMachinesParallel(). Runs one machine of a RunJob headlessly.
+
+[arg] A RunJob.
+[index] Index of the machine to run.
+*/
+void runJob(void* arg, int index) {
+	RunJob* job = (RunJob*) arg;
+	runMachineHeadless(job->machines[index], job->cycles);
+}
+
+
+/*
+[desc]	Runs the machine for a number of cycles, jumping over quiet stretches with
+		advanceToEvent() and stepping through everything else.
+
+[m] The machine to run.
+[cycles] Number of state-machine cycles to run.
+*/
+void advanceMachine(Machine* m, long cycles) {
+	long done = 0;
+	while (done < cycles) {
+		done += advanceToEvent(m, cycles - done);
+		if (done < cycles) {
+			stepMachine(m);
+			done++;
+		}
+	}
+}
+
+
+/*
+[desc]	Next-event time advance. While the machine is idle and no device can run, a
+		cycle only recharges the battery during the day, counts an idle cycle if the
+		battery is low, and inverts daytime every half day. Jumps straight over such
+		a stretch, stopping just before the battery reaches the next level that
+		changes what updateMachine() does. The machine ends up exactly as if
+		stepMachine() had been called once per skipped cycle.
+
+[m] The machine to advance.
+[cycles] Maximum number of cycles to skip.
+
+[ret]	Number of cycles skipped, 0 if the machine is not in a quiet stretch.
+*/
+long advanceToEvent(Machine* m, long cycles) {
+	Battery* b = m->mainBattery;
+	int recharge = m->rechargePerCycle;
+	int lowBelow, low, event = INT_MAX;
+	long skipped = 0, run, flips;
+
+	if (m->trace != NULL || m->weather != NULL || m->machineState != STATE_IDLE || b->max <= 0 || b->remaining < 0 || b->remaining > b->max
+			|| recharge < 0) {
+		return 0;
+	}
+	/* remaining*100 / max < LOW  <=>  remaining < ceil(LOW*max / 100) */
+	lowBelow = (b->lowThreshold * b->max + 99) / 100;
+	low = b->remaining < lowBelow;
+	if (low) {
+		event = lowBelow;
+	} else if (!batteryEvent(m, m->devices[DEVICE_FILTER_PUMP], &event)
+			|| !batteryEvent(m, m->devices[DEVICE_RO_PUMP], &event)
+			|| !batteryEvent(m, m->devices[DEVICE_UV], &event)) {
+		return 0;
+	}
+	if (!batteryEvent(m, m->devices[DEVICE_DRAIN], &event)) {
+		return 0;
+	}
+
+	while (skipped < cycles) {
+		if (recharge == 0 || b->remaining == b->max) {
+			run = cycles - skipped; //The battery can no longer change, so nothing will happen
+		} else {
+			run = HALF_DAY - (m->totalCycles + HALF_DAY - 1) % HALF_DAY; //Cycles left until daytime inverts
+			if (run > cycles - skipped) {
+				run = cycles - skipped;
+			}
+			if (m->daytime) {
+				if (event <= b->max && run > (event - b->remaining - 1) / recharge) {
+					run = (event - b->remaining - 1) / recharge;
+				}
+				b->remaining = b->remaining + run*recharge < b->max ? b->remaining + run*recharge : b->max;
+			}
+		}
+		if (run == 0) {
+			break;
+		}
+
+		if (low) {
+			m->idleCycles += run;
+		}
+		/* Daytime inverts after every cycle where totalCycles % HALF_DAY == 0 */
+		flips = (m->totalCycles + run + HALF_DAY - 1) / HALF_DAY - (m->totalCycles + HALF_DAY - 1) / HALF_DAY;
+		if (flips % 2) {
+			m->daytime = m->daytime ? FALSE : TRUE;
+		}
+		m->totalCycles += run;
+		skipped += run;
+	}
+	return skipped;
+}
+
+
+/*
+[desc]	Helper for advanceToEvent(). Finds the battery level at which a device that
+		can not run now would become available. Tanks do not change while the machine
+		is quiet, so a device blocked by its tanks stays blocked.
+
+[m] The machine the device belongs to.
+[device] The device to examine.
+[event] Lowered to the device's consumption if only the battery is blocking it.
+
+[ret]	0 if the device can already run, 1 otherwise.
+*/
+int batteryEvent(Machine* m, Device* device, int* event) {
+	if (isFull(device->sink) || isEmpty(device->source)) {
+		return 1;
+	}
+	if (device->consumption <= m->mainBattery->remaining) {
+		return 0;
+	}
+	if (device->consumption < *event) {
+		*event = device->consumption;
+	}
+	return 1;
+}
+
+
+/*
+[desc]	Packs everything that decides a machine's future into an array of ints:
+		tank quantities and turbidities, device enables, battery, state and daytime.
+		Counters and totalCycles are left out.
+
+[m] The machine to pack.
+[key] Array to fill.
+*/
+void stateKey(Machine* m, int key[STATE_KEY_SIZE]) {
+	int i;
+	memset(key, 0, sizeof(int) * STATE_KEY_SIZE);
+	for (i=0; i < m->numTanks; i++) {
+		key[2*i] = m->tanks[i]->quantity;
+		key[2*i + 1] = m->tanks[i]->turbidity;
+	}
+	for (i=0; i < m->numDevices; i++) {
+		key[2*MAX_TANK_COUNT + i] = m->devices[i] ? m->devices[i]->enable : 0;
+	}
+	key[STATE_KEY_SIZE - 3] = m->mainBattery->remaining;
+	key[STATE_KEY_SIZE - 2] = m->machineState;
+	key[STATE_KEY_SIZE - 1] = m->daytime;
+}
+
+
 /*
 [desc]	This is the system state-machine. Runs in the following way:
 			If the battery power is low, recharge until BATTERY_FULL_THRESHOLD
 			If a device can run run it, if not try the next one
 				Once a device is running, continue until the 'sink tank' is full or out of power
 					Return to the idle state once a device can no longer run
+
+[m] The machine to update.
 */
-void updateMachine(void) {
+void updateMachine(Machine* m) {
 	int i;
-	Device* filterPump = devices[0];
-	Device* roPump = devices[1];
-	Device* roReject = devices[4];
-	Device* uv = devices[2];
-	Device* drain = devices[3];
+	Device* filterPump = m->devices[DEVICE_FILTER_PUMP];
+	Device* roPump = m->devices[DEVICE_RO_PUMP];
+	Device* roReject = m->devices[DEVICE_RO_REJECT];
+	Device* uv = m->devices[DEVICE_UV];
+	Device* drain = m->devices[DEVICE_DRAIN];
 
-	switch (machineState) {
+	switch (m->machineState) {
 		case STATE_IDLE:
-			if (mainBattery->remaining*100 / mainBattery->max < BATTERY_LOW_THRESHOLD) {
-				idleCycles++;
+			if (m->mainBattery->remaining*100 / m->mainBattery->max < m->mainBattery->lowThreshold) {
+				m->idleCycles++;
 				break;
-			} else if (deviceAvailable(filterPump)) { // Filter pump
+			} else if (deviceAvailable(m, filterPump)) { // Filter pump
 				filterPump->enable = TRUE;
-				machineState = STATE_RUN_FILTER_PUMP;
-			} else if (deviceAvailable(roPump)) { // RO pump
+				m->machineState = STATE_RUN_FILTER_PUMP;
+			} else if (deviceAvailable(m, roPump)) { // RO pump
 				roPump->enable = TRUE;
 				roReject->enable = TRUE;
-				machineState = STATE_RUN_RO_PUMP;
-			} else if (deviceAvailable(uv)) { // UV 
+				m->machineState = STATE_RUN_RO_PUMP;
+			} else if (deviceAvailable(m, uv)) { // UV 
 				uv->enable = TRUE;
-				machineState = STATE_RUN_UV;
+				m->machineState = STATE_RUN_UV;
 			}
 			break;
 
 		case STATE_RUN_FILTER_PUMP:
-			if (deviceAvailable(filterPump)) {
-				runDevice(filterPump);
-				deviceCycles++;
+			if (deviceAvailable(m, filterPump)) {
+				runDevice(m, filterPump);
+				m->deviceCycles++;
 			} else {
 				filterPump->enable = FALSE;
-				if (mainBattery->remaining*100 / mainBattery->max < BATTERY_LOW_THRESHOLD) {
-					machineState = STATE_IDLE;
-				} else if (deviceAvailable(roPump)) { // RO pump
+				if (m->mainBattery->remaining*100 / m->mainBattery->max < m->mainBattery->lowThreshold) {
+					m->machineState = STATE_IDLE;
+				} else if (deviceAvailable(m, roPump)) { // RO pump
 					roPump->enable = TRUE;
 					roReject->enable = TRUE;
-					machineState = STATE_RUN_RO_PUMP;
-				} else if (deviceAvailable(uv)) { // UV 
+					m->machineState = STATE_RUN_RO_PUMP;
+				} else if (deviceAvailable(m, uv)) { // UV 
 					uv->enable = TRUE;
-					machineState = STATE_RUN_UV;
+					m->machineState = STATE_RUN_UV;
 				}
 			}
 			break;
 
 		case STATE_RUN_RO_PUMP:
-			if (deviceAvailable(roPump)) {
-				runDevice(roPump);
-				waterRejected += runDevice(roReject);
-				deviceCycles++;
-				waterRejected += runDevice(roReject);
+			if (deviceAvailable(m, roPump)) {
+				runDevice(m, roPump);
+				m->waterRejected += runDevice(m, roReject);
+				m->deviceCycles++;
+				m->waterRejected += runDevice(m, roReject);
 			} else {
 				roPump->enable = FALSE;
 				roReject->enable = FALSE;
-				if (mainBattery->remaining*100 / mainBattery->max < BATTERY_LOW_THRESHOLD) {
-					machineState = STATE_IDLE;
-				} else if (deviceAvailable(filterPump)) { // Filter pump
+				if (m->mainBattery->remaining*100 / m->mainBattery->max < m->mainBattery->lowThreshold) {
+					m->machineState = STATE_IDLE;
+				} else if (deviceAvailable(m, filterPump)) { // Filter pump
 					filterPump->enable = TRUE;
-					machineState = STATE_RUN_FILTER_PUMP;
-				} else if (deviceAvailable(uv)) { // UV 
+					m->machineState = STATE_RUN_FILTER_PUMP;
+				} else if (deviceAvailable(m, uv)) { // UV 
 					uv->enable = TRUE;
-					machineState = STATE_RUN_UV;
+					m->machineState = STATE_RUN_UV;
 				}
 			}
 			break;
 
 		case STATE_RUN_UV:
-			if (deviceAvailable(uv)) {
-				waterPurified += runDevice(uv);
-				deviceCycles++;
+			if (deviceAvailable(m, uv)) {
+				m->waterPurified += runDevice(m, uv);
+				m->deviceCycles++;
 			} else {
 				uv->enable = FALSE;
-				if (mainBattery->remaining*100 / mainBattery->max < BATTERY_LOW_THRESHOLD) {
-					machineState = STATE_IDLE;
-				} else if (deviceAvailable(filterPump)) { // Filter pump
+				if (m->mainBattery->remaining*100 / m->mainBattery->max < m->mainBattery->lowThreshold) {
+					m->machineState = STATE_IDLE;
+				} else if (deviceAvailable(m, filterPump)) { // Filter pump
 					filterPump->enable = TRUE;
-					machineState = STATE_RUN_FILTER_PUMP;
-				} else if (deviceAvailable(roPump)) { // RO pump
+					m->machineState = STATE_RUN_FILTER_PUMP;
+				} else if (deviceAvailable(m, roPump)) { // RO pump
 					roPump->enable = TRUE;
 					roReject->enable = TRUE;
-					machineState = STATE_RUN_RO_PUMP;
+					m->machineState = STATE_RUN_RO_PUMP;
 				}
 			}
 			break;
 	};
 	
-	// for(i=0; devices[i] != NULL && i < MAX_TANK_COUNT; i++) {
-	// 	if (devices[i]->enable) {
-	// 		runDevice(devices[i]);
+	// for(i=0; m->devices[i] != NULL && i < MAX_TANK_COUNT; i++) {
+	// 	if (m->devices[i]->enable) {
+	// 		runDevice(m->devices[i]);
 	// 	}
 	// }
-	if (deviceAvailable(drain)) {
+	if (deviceAvailable(m, drain)) {
 		drain->enable = TRUE;
-		runDevice(drain);
+		runDevice(m, drain);
 		drain->enable = FALSE;
 	}
 }
 
 /*
-[desc]	Removes energy from the global battery if consumption is less than the energy
+[desc]	Adds a cycle's solar energy to the machine's battery, capped at its max. Follows
+		the machine's weather when it has one, otherwise a fixed amount in daytime.
+
+[m] The machine whose battery to recharge.
+*/
+void rechargeBattery(Machine* m) {
+	if (m->weather) {
+		m->mainBattery->remaining += weatherRecharge(m->weather, m->totalCycles, m->rechargePerCycle);
+	} else {
+		m->mainBattery->remaining += m->daytime ? m->rechargePerCycle : 0; //recharge if its daytime
+	}
+	if (m->mainBattery->remaining > m->mainBattery->max) { //cap refilling at battery max
+		m->mainBattery->remaining = m->mainBattery->max;
+	}
+}
+
+
+/*
+[desc]	Removes energy from the machine's battery if consumption is less than the energy
 		remining in the battery.
 
+[m] The machine whose battery to drain.
 [consumption] Amount of energy to remove from the battery.
 
 [ret]	Returns 1 if the battery has enough energy remaining, 0 otherwise.
 */
-int drainBattery(int consumption) {
-	if (mainBattery->remaining < consumption) {
+int drainBattery(Machine* m, int consumption) {
+	if (m->mainBattery->remaining < consumption) {
 		return 0;
 	}
-	mainBattery->remaining = mainBattery->remaining - consumption;
+	m->mainBattery->remaining = m->mainBattery->remaining - consumption;
 	return 1;
 }
 
@@ -392,10 +776,13 @@ int drainBattery(int consumption) {
 
 [ret]	Water moved between tanks.
 */
-int moveWater(Tank* source, Tank* sink, int amount, float sourceTurbidity) {
-	/* set new turbidity for sink using weighted average */
-	sink->turbidity = ( (sourceTurbidity*(float)amount) + (float)(sink->turbidity*sink->quantity) ) /
-		(float)(sink->quantity + amount);
+int moveWater(Tank* source, Tank* sink, int amount, int sourceTurbidity) {
+	/* set new turbidity for sink using weighted average, rounded to nearest */
+	long long total = (long long)sink->quantity + amount;
+	if (total > 0) {
+		sink->turbidity = (int)( ((long long)sourceTurbidity*amount + (long long)sink->turbidity*sink->quantity + total/2) /
+			total );
+	}
 
 	if (amount > source->quantity) { //Source doesnt have enough
 		amount = source->quantity;
@@ -417,80 +804,43 @@ int moveWater(Tank* source, Tank* sink, int amount, float sourceTurbidity) {
 		water turbidity from the device specified. Does no checking on whether water should 
 		actually be moved.
 
+[m] The machine the device belongs to.
 [device] A device to run.
 
 [ret]	Returns the amount of water moved.
 */
-int runDevice(Device* device) {
-	float sourceTurbidity;
-	if (device->newTurbidity < device->source->turbidity && device->newTurbidity >= 0.0) {
+int runDevice(Machine* m, Device* device) {
+	int sourceTurbidity;
+	if (device->newTurbidity < device->source->turbidity && device->newTurbidity >= 0) {
 		sourceTurbidity = device->newTurbidity;
 	} else {
 		sourceTurbidity = device->source->turbidity;
 	}
-	if (!infiniteEnergy){
-		drainBattery(device->consumption);
+	if (!m->infiniteEnergy){
+		drainBattery(m, device->consumption);
 	}
+	m->energyUsed += device->consumption;
 	return moveWater(device->source, device->sink, device->flowRate, sourceTurbidity);
 }
 
-/*
-[desc]	Determines whether or not a tank's quantity is above TANK_FULL_TRESHOLD% full.
-
-[tank] A tank to examine.
-
-[ret]	1 if the tank is full, 0 otherwise.
-*/
-int isFull(Tank* tank) {
-	int vol = tank->volume;
-	int qty = tank->quantity;
-	return (TANK_FULL_THRESHOLD <= (float)qty / (float)vol * 100)? TRUE: FALSE;
-}
-
-/*
-[desc]	Determines whether or not a tank's quantity is below TANK_LOW_TRESHOLD% full.
-
-[tank] A tank to examine.
-
-[ret]	1 if the tank is empty, 0 otherwise.
-*/
-int isEmpty(Tank* tank) {
-	int vol = tank->volume;
-	int qty = tank->quantity;
-	return (TANK_LOW_THRESHOLD >= (float)qty / (float)vol * 100)? TRUE: FALSE;
-}
-
 /*
 [desc]	Determines whether or not a device can be run for the next cycle based
 		on power to be consumed, and the fullness of the source tank.
 
+[m] The machine the device belongs to.
 [tank] A device to examine.
 
 [ret]	1 if the device can run, 0 otherwise.
 */
-int deviceAvailable(Device* device) {
+int deviceAvailable(Machine* m, Device* device) {
 	if (!isFull(device->sink) && !isEmpty(device->source) &&
-			device->consumption <= mainBattery->remaining) {
+			device->consumption <= m->mainBattery->remaining) {
 		return 1;
 	} else {
 		return 0;
 	}
 }
 
-/*
-[desc]	Loops for dly amount of time.
-
-[dly] Delay in seconds.
-*/
-void delay(double dly){
-    clock_t ticks1, ticks2;
-
-	ticks1=clock();
-	ticks2=ticks1;
-	while(((double)ticks2/CLOCKS_PER_SEC - (double)ticks1/CLOCKS_PER_SEC) < dly)
-		ticks2=clock();
-}
-
 
 //––––––––––––––––––––––––––––––  Print Functions  ––––––––––––––––––––––––––––––//
 
@@ -498,9 +848,10 @@ void delay(double dly){
 [desc]	Prints a visual representation of the fullness of all tanks in an array.
 		Loads tank stages into a 2D array using the stageTank() helper function.
 
+[r] The renderer to print into.
 [tanks] An array of tanks to print. Must be MAX_TANK_COUNT in length.
 */
-void printTanks(Tank* tanks[MAX_TANK_COUNT]) {
+void printTanks(Renderer* r, Tank* tanks[MAX_TANK_COUNT]) {
 	char lineStage[TANK_PRINT_HEIGHT][MAX_TANK_COUNT * (TANK_PRINT_WIDTH + SPACING)] = {};
 	char tankStage[TANK_PRINT_HEIGHT][TANK_PRINT_WIDTH] = {};
 
@@ -526,13 +877,10 @@ void printTanks(Tank* tanks[MAX_TANK_COUNT]) {
 		l += TANK_PRINT_WIDTH + SPACING; //Start index of new tank	
 	}
 
-	//print entire stage
-	printf("\n\r");
+	//print entire stage, one line at a time
+	renderPrint(r, "\n\r");
 	for(i = TANK_PRINT_HEIGHT - 1; i >= 0; i--) {
-		for(j = 0; j < numTanks*(TANK_PRINT_WIDTH + SPACING); j++) {
-			printf("%c", lineStage[i][j]);
-		}
-		printf("\n\r");
+		renderPrint(r, "%.*s\n\r", numTanks*(TANK_PRINT_WIDTH + SPACING), lineStage[i]);
 	}
 }
 
@@ -563,67 +911,63 @@ void stageTank(char tankStage[][TANK_PRINT_WIDTH], Tank* tank) {
 /*
 [desc]	Prints the turbidities of all tanks in tankArr on one line.
 
+[r] The renderer to print into.
 [tanks] An array of tanks to print. Must be MAX_TANK_COUNT in length.
 */
-void printTurbidities(Tank* tankArr[MAX_TANK_COUNT]) {
+void printTurbidities(Renderer* r, Tank* tankArr[MAX_TANK_COUNT]) {
 	int i;
 	for (i=0; tankArr[i] != NULL && i < MAX_TANK_COUNT; i++) {
-		printf("%04.2f   ", tankArr[i]->turbidity);
+		renderPrint(r, "%04.2f   ", (double)tankArr[i]->turbidity / TURBIDITY_SCALE);
 	}
-	printf("\n\r");
+	renderPrint(r, "\n\r");
 }
 
 /*
 [desc]	Prints the battery statistics.
 
-[battery] A battery to print stats for.
+[r] The renderer to print into.
+[m] The machine whose battery to print stats for.
 */
-void printBattery(Battery* battery) {
-	printf("\n\rBattery %%: %d", battery->remaining*100/battery->max);
-	printf("\n\rDaytime: %s\n\n\r", daytime ? "Yes" : "No");
+void printBattery(Renderer* r, Machine* m) {
+	renderPrint(r, "\n\rBattery %%: %d", m->mainBattery->remaining*100/m->mainBattery->max);
+	renderPrint(r, "\n\rDaytime: %s\n\n\r", m->daytime ? "Yes" : "No");
 }
 
 /*
 [desc]	Prints debug statistics.
+
+[r] The renderer to print into.
+[m] The machine to print.
 */
-void printDebug(void) {
+void printDebug(Renderer* r, Machine* m) {
 	char state[30] = {};
-	if (machineState == 0) {
+	if (m->machineState == 0) {
 		sprintf(state, "STATE_IDLE");
-	} else if (machineState == 1) {
+	} else if (m->machineState == 1) {
 		sprintf(state, "STATE_RUN_FILTER_PUMP");
-	} else if (machineState == 2) {
+	} else if (m->machineState == 2) {
 		sprintf(state, "STATE_RUN_RO_PUMP");
-	} else if (machineState == 3) {
+	} else if (m->machineState == 3) {
 		sprintf(state, "STATE_RUN_UV");
 	}
-	printf("\n\r[DEBUG STATS]");
-	printf("\n\r\tState: %s -- %d", state, machineState);
-	printf("\n\r\tTotal State-machine Cycles: %d", totalCycles);
-	printf("\n\r\tTotal Idle Cycles: %d", idleCycles);
-	printf("\n\r\tDevice Cycles: %d", deviceCycles);
-	printf("\n\r[END]\n\r");
+	renderPrint(r, "\n\r[DEBUG STATS]");
+	renderPrint(r, "\n\r\tState: %s -- %d", state, m->machineState);
+	renderPrint(r, "\n\r\tTotal State-machine Cycles: %ld", m->totalCycles);
+	renderPrint(r, "\n\r\tTotal Idle Cycles: %ld", m->idleCycles);
+	renderPrint(r, "\n\r\tDevice Cycles: %ld", m->deviceCycles);
+	renderPrint(r, "\n\r[END]\n\r");
 }
 
 /*
-[desc]	Prints all of the optional graphics for the simulator.
-*/
-void printGraphics(void) {
-	system("clear");
-	printTanks(tanks);
-	printTurbidities(tanks);
-	printBattery(mainBattery);
-	// printDebug();
-}
+[desc]	Prints all of the statistics for a machine.
 
-/*
-[desc]	Prints all of the global statistics for the simulator.
+[m] The machine to print.
 */
-void printStats(void) {
-	printf("[total idle cycles] %d\n\r", idleCycles);
-	printf("[total 'device on' cycles] %d\n\r" , deviceCycles);
-	printf("[water purified] %d\n\r" , waterPurified);
-	printf("[water rejected] %d\n\r" , waterRejected);
+void printStats(Machine* m) {
+	printf("[total idle cycles] %ld\n\r", m->idleCycles);
+	printf("[total 'device on' cycles] %ld\n\r" , m->deviceCycles);
+	printf("[water purified] %ld\n\r" , m->waterPurified);
+	printf("[water rejected] %ld\n\r" , m->waterRejected);
 
 }
 
@@ -5,40 +5,294 @@
 	Library to simulate a machine with flowing water moving between tanks.
 	Devices move the water from one tank to the next. Currently this is a
 	non-abstracted library, meaning you should change the source to modify
-	the operation of the defaultMachineInit() and runMachine state-machine.
+	the operation of the defaultMachine() and runMachine state-machine.
 
+	All state lives in a Machine context, so any number of machines can be
+	simulated at once, each from its own thread.
 */
 
 #ifndef WATER_MACHINE_H
 #define WATER_MACHINE_H
 
+#include "threadPool.h"
+#include "render.h"
+
+
+#define MAX_DEVICE_COUNT 10
+#define MAX_TANK_COUNT MAX_DEVICE_COUNT
+#define INFINITE_VOLUME 999999 //Volume and quantity of a limitless tank
+
+/* Turbidities are fixed-point in thousandths of a unit, so the physics needs no FPU.
+   TURBIDITY() converts from units and evaluates its argument twice. */
+#define TURBIDITY_SCALE 1000
+#define TURBIDITY(units) ((int)((units) * TURBIDITY_SCALE + ((units) < 0 ? -0.5 : 0.5)))
+
+/* Defaults for the thresholds each Tank and Battery carries */
+#define TANK_FULL_THRESHOLD 90
+#define TANK_LOW_THRESHOLD 5
+#define BATTERY_FULL_THRESHOLD 90
+#define BATTERY_LOW_THRESHOLD 20 //Percentage of energy at which the machine waits to recharge
+#define CYCLES_PER_DAY 24 // hours/day
+#define HALF_DAY (CYCLES_PER_DAY / 2)
+
+
+/* Tank and device indexes of the default machine */
+enum DefaultTanks {
+	TANK_SOURCE,
+	TANK_FILTERED,
+	TANK_PERMEATE,
+	TANK_DISINFECTED,
+	TANK_SINK,
+	DEFAULT_TANK_COUNT,
+};
+
+enum DefaultDevices {
+	DEVICE_FILTER_PUMP,
+	DEVICE_RO_PUMP,
+	DEVICE_UV,
+	DEVICE_DRAIN,
+	DEVICE_RO_REJECT,
+	DEFAULT_DEVICE_COUNT,
+};
+
+
+typedef struct Tank {
+	int volume;
+	int quantity;
+	int turbidity; //Fixed-point, see TURBIDITY_SCALE
+	int fullThreshold; //Percentage at or above which the tank is full
+	int lowThreshold; //Percentage at or below which the tank is empty
+	int fullAt; //Smallest full quantity, set by tankThresholds()
+	int emptyAt; //Largest empty quantity, set by tankThresholds()
+} Tank;
+
+typedef struct Device {
+	int enable;
+	int flowRate;
+	int consumption;
+	int newTurbidity; //Fixed-point, negative to pass water through unchanged
+	Tank* source;
+	Tank* sink;
+} Device;
+
+typedef struct Battery {
+	int remaining;
+	int max;
+	int lowThreshold; //Percentage below which the machine waits to recharge
+} Battery;
+
+typedef enum {
+	STATE_IDLE,
+	STATE_RUN_FILTER_PUMP,
+	STATE_RUN_RO_PUMP,
+	STATE_RUN_UV,
+} MachineStates;
+
+typedef struct Machine {
+	Tank* tanks[MAX_TANK_COUNT];
+	int numTanks;
+	Device* devices[MAX_DEVICE_COUNT];
+	int numDevices;
+	Battery* mainBattery;
+	int rechargePerCycle; //Energy added to the battery each daytime cycle
+	MachineStates machineState;
+	int infiniteEnergy;
+	int daytime;
+	long totalCycles;
+	long deviceCycles;
+	long idleCycles;
+	long waterPurified;
+	long waterRejected;
+	long energyUsed; //Consumption of every device run
+	struct TraceWriter* trace; //Records every cycle when set, see trace.h
+	struct Weather* weather; //Recharges from real weather when set, see weather.h
+} Machine;
+
+typedef struct MachineStats {
+	long totalCycles;
+	long deviceCycles;
+	long idleCycles;
+	long waterPurified;
+	long waterRejected;
+	long energyUsed;
+	int batteryRemaining;
+	int batteryMax;
+} MachineStats;
+
+typedef struct DeviceSnapshot {
+	int present; //0 where the machine has no device
+	int enable;
+	int flowRate;
+	int consumption;
+	int newTurbidity;
+	int source; //Index of the source tank
+	int sink; //Index of the sink tank
+} DeviceSnapshot;
+
+/* Full state of a machine with no pointers, so it can be copied around as a flat buffer */
+typedef struct MachineSnapshot {
+	Tank tanks[MAX_TANK_COUNT];
+	int numTanks;
+	DeviceSnapshot devices[MAX_DEVICE_COUNT];
+	int numDevices;
+	Battery mainBattery;
+	int rechargePerCycle;
+	MachineStates machineState;
+	int infiniteEnergy;
+	int daytime;
+	long totalCycles;
+	long deviceCycles;
+	long idleCycles;
+	long waterPurified;
+	long waterRejected;
+	long energyUsed;
+} MachineSnapshot;
+
 
 //––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
 
 /*
-[desc]	Initializes the default machine. Currently the only machine implementation is
+[desc]	Constructor for the default machine. Currently the only machine implementation is
 		the default machine. Does not start the machine.
+
+[ret]	A pointer to the newly created machine. Free it with freeMachine().
 */
-void defaultMachineInit(void);
+Machine* defaultMachine(void);
 
 /*
-[desc]	Initializes the default machine. Currently the only machine implementation is
-		the default machine. Does not start the machine. To run the program as quickly
-		as possible, set timePerCycle = 0 and set graphicsEnable = 0.
+[desc]	Frees a machine along with all of its tanks, devices and battery.
 
+[m] The machine to free. May be NULL.
+*/
+void freeMachine(Machine* m);
+
+/*
+[desc]	Runs the machine. To run the program as quickly as possible, set
+		timePerCycle = 0 and set graphicsEnable = 0.
+
+[m]	The machine to run.
 [cycles]	Number of machine cycles to execute
 [timePerCycle]	Amount of time in seconds per machine cycle.
 				Set this to 0 to run the program as quickly as possbile.
-			   
+
+*/
+void runMachine(Machine* m, int cycles, float timePerCycle, int graphicsEnable);
+
+/*
+[desc]	Runs the machine without any terminal output or delays. Intended for batch
+		runs where only the final statistics matter. Unlike runMachine(), cycles
+		counts every state-machine cycle, not just idle and 'device on' cycles.
+		Quiet stretches are jumped over in one step, and once the machine settles
+		into a repeating daily pattern whole periods are skipped at once. Results
+		are identical to stepping every cycle.
+
+[m]	The machine to run.
+[cycles]	Number of state-machine cycles to execute
+*/
+void runMachineHeadless(Machine* m, long cycles);
+
+/*
+[desc]	Runs a single machine cycle: recharges the battery, runs the
+		state-machine once, and inverts daytime every half day.
+
+[m] The machine to step.
+*/
+void stepMachine(Machine* m);
+
+/*
+[desc]	Runs a single cycle with the devices left as they are enabled, skipping the
+		built-in state machine. For outside controllers such as the firmware
+		co-simulation in cosim/. Every enabled device with enough energy runs once.
+		Water through the UV device counts as purified and through the RO reject as
+		rejected.
+
+[m]	The machine to step.
+*/
+void stepDevices(Machine* m);
+
+/*
+[desc]	Runs many independent machines headlessly, spread across the threads of a pool.
+		Blocks until every machine has run for the given number of cycles.
+
+[pool] The thread pool to run on.
+[machines] Array of machines to run. Each machine is only touched by one thread.
+[count] Number of machines in the array.
+[cycles] Number of state-machine cycles to run each machine for.
+*/
+void runMachinesParallel(ThreadPool* pool, Machine* machines[], int count, long cycles);
+
+/*
+[desc]	Returns a copy of the machine's running statistics.
+
+[m]	The machine to examine.
+
+[ret]	A MachineStats struct holding the counters of the machine.
+*/
+MachineStats machineStats(Machine* m);
+
+/*
+[desc]	Prints all of the optional graphics for the simulator into the renderer's
+		next frame.
+
+[r] The renderer to print into.
+[m] The machine to draw.
+*/
+void printGraphics(Renderer* r, Machine* m);
+
+/*
+[desc]	Precomputes a tank's integer fill levels from its volume and threshold
+		percentages, so isFull() and isEmpty() are single integer compares. Call
+		after changing any of them.
+
+[tank] The tank to update.
+*/
+void tankThresholds(Tank* tank);
+
+/*
+[desc]	Determines whether or not a tank's quantity is at or above its fullThreshold%.
+
+[tank] A tank to examine.
+
+[ret]	1 if the tank is full, 0 otherwise.
+*/
+int isFull(Tank* tank);
+
+/*
+[desc]	Determines whether or not a tank's quantity is at or below its lowThreshold%.
+
+[tank] A tank to examine.
+
+[ret]	1 if the tank is empty, 0 otherwise.
+*/
+int isEmpty(Tank* tank);
+
+/*
+[desc]	Copies the full state of a machine into a snapshot. The machine's trace is not
+		part of the snapshot.
+
+[m] The machine to copy.
+[snapshot] Filled in with the machine's state.
 */
-void runMachine(int cycles, float timePerCycle, int graphicsEnable);
+void snapshotMachine(Machine* m, MachineSnapshot* snapshot);
+
+/*
+[desc]	Constructor for a machine holding the state in a snapshot. Can be called any
+		number of times on one snapshot to branch independent copies.
+
+[snapshot] The state to restore.
+
+[ret]	A pointer to the new machine. Free it with freeMachine().
+*/
+Machine* restoreMachine(const MachineSnapshot* snapshot);
 
 /*
 [desc]	Toggles infiniteEnergy. Used to decide whether or not the mainBattery is drained.
 
+[m]	The machine to toggle.
+
 [ret]	The new value of infiniteEnergy, either 1 or 0.
 */
-int togglePower(void);
+int togglePower(Machine* m);
 
 
-#endif //SHELL_H
\ No newline at end of file
+#endif //SHELL_H
@@ -3,22 +3,178 @@
 	Dec 7, 2016
 
 	Playground for waterlab one testing state machine
+
+	Usage:
+		./main.o                Interactive shell
+		./main.o -b <cycles>    Headless batch run, prints a one line summary
+		    -i                  Infinite energy for the batch run
+		    -p <runs>           Run <runs> independent machines in parallel
+		    -t <threads>        Worker threads for -p, defaults to one per core
+		./main.o -m <runs>      Monte Carlo batch, prints percentile tables
+		    -b <cycles>         Cycles per run, defaults to one year
+		    -s <seed>           Seed for the batch
+		    -t <threads>        Worker threads, defaults to one per core
+		./main.o -f <units>     SIMD fleet of <units> Monte Carlo machines, prints totals
+		    -b, -s, -t          As for -m
+		./main.o -b <cycles> -o <file>    Batch run of one machine, recording every cycle to a trace
+		./main.o -b <cycles> -w <file>    Batch run recharging from an hourly weather file
+		    -x <file>           Also converts the weather file to binary
+		./main.o -u <generations>    Tunes thresholds and flow rates for water purified per energy
+		    -b, -s, -t          As for -m
+		    -p <candidates>     Candidates per generation
+		./main.o -n <files...>  Runs scenario files concurrently, see scenario.h
+		    -t <threads>        Worker threads, defaults to one per core
+		./main.o -r <file>      Summarizes a trace file
+		    -c <first>[:<last>] Replays a range of cycles on screen
+		    -e                  Exports the range, or the whole trace, as CSV instead
 */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <unistd.h>
 #include "shell.h"
 #include "machine.h"
+#include "threadPool.h"
+#include "monteCarlo.h"
+#include "fleet.h"
+#include "trace.h"
+#include "weather.h"
+#include "tuner.h"
+#include "scenario.h"
+
+
+#define CYCLES_PER_YEAR (24 * 365)
+#define REPLAY_SECONDS_PER_CYCLE 0.01
+#define REPLAY_ROWS 24
+#define REPLAY_COLS 80
+#define REPLAY_FPS 30
+
+
+//––––––  Private Declarations  ––––––//
+int runBatch(long cycles, int infinitePower, int runs, int threads, char* tracePath, char* weatherPath);
+int convertWeather(char* weatherPath, char* binaryPath);
+int runMonteCarloBatch(long cycles, int runs, uint64_t seed, int threads);
+int runFleetBatch(long cycles, int units, uint64_t seed, int threads);
+int runTunerBatch(long cycles, int generations, int population, uint64_t seed, int threads);
+int runScenarioBatch(char* paths[], int count, int threads);
+int runReplay(char* path, long first, long last, int export);
+double wallSeconds(void);
+void printUsage(char* name);
+
 
 int main (int argc, char* argv[]) {
+	long batchCycles = 0;
+	int infinitePower = 0;
+	int runs = 1;
+	int threads = 0;
+	int monteCarloRuns = 0;
+	int fleetUnits = 0;
+	int generations = 0;
+	uint64_t seed = 1;
+	char* tracePath = NULL;
+	char* replayPath = NULL;
+	char* weatherPath = NULL;
+	char* binaryPath = NULL;
+	long first = 0, last = -1;
+	int export = 0;
+	int scenarios = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "b:ip:t:m:s:f:o:r:c:ew:x:u:nh")) != -1) {
+		switch (opt) {
+			case 'b':
+				batchCycles = atol(optarg);
+				break;
+			case 'i':
+				infinitePower = 1;
+				break;
+			case 'p':
+				runs = atoi(optarg);
+				break;
+			case 't':
+				threads = atoi(optarg);
+				break;
+			case 'm':
+				monteCarloRuns = atoi(optarg);
+				break;
+			case 's':
+				seed = strtoull(optarg, NULL, 0);
+				break;
+			case 'f':
+				fleetUnits = atoi(optarg);
+				break;
+			case 'o':
+				tracePath = optarg;
+				break;
+			case 'r':
+				replayPath = optarg;
+				break;
+			case 'c':
+				if (sscanf(optarg, "%ld:%ld", &first, &last) == 1) {
+					last = first;
+				}
+				break;
+			case 'e':
+				export = 1;
+				break;
+			case 'w':
+				weatherPath = optarg;
+				break;
+			case 'x':
+				binaryPath = optarg;
+				break;
+			case 'u':
+				generations = atoi(optarg);
+				break;
+			case 'n':
+				scenarios = 1;
+				break;
+			default:
+				printUsage(argv[0]);
+				return opt == 'h' ? 0 : 1;
+		}
+	}
+	if (weatherPath && binaryPath) {
+		if (convertWeather(weatherPath, binaryPath) != 0) {
+			return 1;
+		}
+		if (batchCycles == 0) {
+			return 0;
+		}
+	}
+	if (replayPath) {
+		return runReplay(replayPath, first, last, export);
+	}
+	if (scenarios) {
+		if (optind == argc) {
+			printUsage(argv[0]);
+			return 1;
+		}
+		return runScenarioBatch(&argv[optind], argc - optind, threads);
+	}
+	if (generations > 0) {
+		return runTunerBatch(batchCycles > 0 ? batchCycles : CYCLES_PER_YEAR,
+				generations, runs > 1 ? runs : 0, seed, threads);
+	}
+	if (fleetUnits > 0) {
+		return runFleetBatch(batchCycles > 0 ? batchCycles : CYCLES_PER_YEAR,
+				fleetUnits, seed, threads);
+	}
+	if (monteCarloRuns > 0) {
+		return runMonteCarloBatch(batchCycles > 0 ? batchCycles : CYCLES_PER_YEAR,
+				monteCarloRuns, seed, threads);
+	}
+	if (batchCycles > 0) {
+		return runBatch(batchCycles, infinitePower, runs, threads, tracePath, weatherPath);
+	}
+
 	//system("/bin/stty raw echo inlcr");
 	system("clear");
 	printf("----- Machine -----\n\n\r");
 	printf("\n\r%s", SHELL_PROMPT);
 
-	defaultMachineInit();
-	
+	shellInit();
+
 	while(shell(getchar()));
 
 	//system ("/bin/stty sane");
@@ -27,5 +183,372 @@ int main (int argc, char* argv[]) {
 }
 
 
+/*
+[desc]	Runs copies of the default machine for a number of cycles without terminal output,
+		then prints a single key=value summary line to stdout. Statistics are summed
+		over every run.
+
+[cycles] Number of state-machine cycles to run each machine for.
+[infinitePower] Nonzero to run with infiniteEnergy on.
+[runs] Number of independent machines to run. More than one runs them on a thread pool.
+[threads] Worker threads for the pool, 0 for one per core.
+[tracePath] File to record every cycle of a single run to, or NULL.
+[weatherPath] Hourly weather file to recharge every machine from, or NULL.
+
+[ret]	Exit status for main.
+*/
+int runBatch(long cycles, int infinitePower, int runs, int threads, char* tracePath, char* weatherPath) {
+	ThreadPool* pool = NULL;
+	TraceWriter* trace = NULL;
+	Weather** weathers = NULL;
+	Machine** machines;
+	MachineStats total = {};
+	MachineStats stats;
+	double start, elapsed;
+	int i;
+
+	if (runs < 1) {
+		runs = 1;
+	}
+	machines = (Machine**) malloc(sizeof(Machine*) * runs);
+	for (i=0; i < runs; i++) {
+		machines[i] = defaultMachine();
+		if (infinitePower) {
+			togglePower(machines[i]);
+		}
+	}
+	if (weatherPath) {
+		/* One per machine since each keeps a read cursor, the file's pages are shared */
+		weathers = (Weather**) calloc(runs, sizeof(Weather*));
+		for (i=0; i < runs; i++) {
+			if ((weathers[i] = weather(weatherPath)) == NULL) {
+				printf("Could not read weather from %s\n", weatherPath);
+				return 1;
+			}
+			machines[i]->weather = weathers[i];
+		}
+	}
+	if (runs > 1) {
+		pool = threadPool(threads);
+	}
+	if (tracePath) {
+		if (runs > 1 || (trace = traceWriter(tracePath, machines[0])) == NULL) {
+			printf("Could not trace to %s%s\n", tracePath, runs > 1 ? ": only single runs are traced" : "");
+			return 1;
+		}
+		machines[0]->trace = trace;
+	}
+
+	start = wallSeconds();
+	if (pool) {
+		runMachinesParallel(pool, machines, runs, cycles);
+	} else {
+		runMachineHeadless(machines[0], cycles);
+	}
+	elapsed = wallSeconds() - start;
+
+	freeTraceWriter(trace);
+	for (i=0; i < runs; i++) {
+		stats = machineStats(machines[i]);
+		total.totalCycles += stats.totalCycles;
+		total.idleCycles += stats.idleCycles;
+		total.deviceCycles += stats.deviceCycles;
+		total.waterPurified += stats.waterPurified;
+		total.waterRejected += stats.waterRejected;
+		total.batteryRemaining += stats.batteryRemaining;
+		total.batteryMax += stats.batteryMax;
+		freeMachine(machines[i]);
+		if (weathers) {
+			freeWeather(weathers[i]);
+		}
+	}
+	printf("runs=%d threads=%d cycles=%ld idle_cycles=%ld device_cycles=%ld water_purified=%ld "
+			"water_rejected=%ld battery=%d/%d seconds=%.6f cycles_per_sec=%.0f\n",
+			runs, pool ? poolSize(pool) : 1, total.totalCycles, total.idleCycles,
+			total.deviceCycles, total.waterPurified, total.waterRejected, total.batteryRemaining,
+			total.batteryMax, elapsed, elapsed > 0 ? total.totalCycles / elapsed : 0.0);
+
+	freeThreadPool(pool);
+	free(weathers);
+	free(machines);
+	return 0;
+}
+
+
+/*
+[desc]	Converts a weather file to the binary format and prints a one line summary.
+
+[weatherPath] CSV or binary weather file to read.
+[binaryPath] Binary weather file to write.
+
+[ret]	Exit status for main.
+*/
+int convertWeather(char* weatherPath, char* binaryPath) {
+	Weather* w = weather(weatherPath);
+	if (w == NULL) {
+		printf("Could not read weather from %s\n", weatherPath);
+		return 1;
+	}
+	if (!weatherWriteBinary(w, binaryPath)) {
+		printf("Could not write weather to %s\n", binaryPath);
+		freeWeather(w);
+		return 1;
+	}
+	printf("hours=%ld written=%s\n", weatherLength(w), binaryPath);
+	freeWeather(w);
+	return 0;
+}
+
+
+/*
+[desc]	Runs a Monte Carlo batch of randomized default machines and prints percentile
+		tables of the results, followed by a key=value timing line.
+
+[cycles] Number of state-machine cycles per run.
+[runs] Number of randomized runs.
+[seed] Seed for the batch. The same seed always gives the same tables.
+[threads] Worker threads for the pool, 0 for one per core.
+
+[ret]	Exit status for main.
+*/
+int runMonteCarloBatch(long cycles, int runs, uint64_t seed, int threads) {
+	ThreadPool* pool = threadPool(threads);
+	MonteCarloConfig config = monteCarloDefaults(runs, cycles, seed);
+	MonteCarloResults* results;
+	double start, elapsed;
+
+	start = wallSeconds();
+	results = runMonteCarlo(&config, pool);
+	elapsed = wallSeconds() - start;
+
+	printMonteCarloTable(results);
+	printf("runs=%d threads=%d cycles=%ld seed=%llu seconds=%.6f runs_per_sec=%.1f\n",
+			runs, poolSize(pool), cycles, (unsigned long long)seed, elapsed,
+			elapsed > 0 ? runs / elapsed : 0.0);
+
+	freeMonteCarloResults(results);
+	freeThreadPool(pool);
+	return 0;
+}
+
+
+/*
+[desc]	Builds a fleet of randomized machines, using the same scenarios as a Monte Carlo
+		batch with the same seed, and runs it with the SIMD fleet kernel. Prints fleet
+		totals and unit-cycles per second as a key=value line.
+
+[cycles] Number of state-machine cycles per unit.
+[units] Number of machines in the fleet.
+[seed] Seed for the scenarios.
+[threads] Worker threads for the pool, 0 for one per core.
+
+[ret]	Exit status for main.
+*/
+int runFleetBatch(long cycles, int units, uint64_t seed, int threads) {
+	MonteCarloConfig config = monteCarloDefaults(units, cycles, seed);
+	ThreadPool* pool = threadPool(threads);
+	Machine** machines = (Machine**) malloc(sizeof(Machine*) * units);
+	MachineStats total = {};
+	MachineStats stats;
+	Fleet* f;
+	double start, elapsed;
+	int i;
+
+	for (i=0; i < units; i++) {
+		machines[i] = monteCarloMachine(&config, i);
+	}
+	f = fleet(machines, units);
+	for (i=0; i < units; i++) {
+		freeMachine(machines[i]);
+	}
+	free(machines);
+
+	start = wallSeconds();
+	runFleet(f, cycles, pool);
+	elapsed = wallSeconds() - start;
+
+	for (i=0; i < units; i++) {
+		stats = fleetStats(f, i);
+		total.idleCycles += stats.idleCycles;
+		total.deviceCycles += stats.deviceCycles;
+		total.waterPurified += stats.waterPurified;
+		total.waterRejected += stats.waterRejected;
+	}
+	printf("units=%d threads=%d cycles=%ld idle_cycles=%ld device_cycles=%ld water_purified=%ld "
+			"water_rejected=%ld seconds=%.6f unit_cycles_per_sec=%.0f\n",
+			units, poolSize(pool), cycles, total.idleCycles, total.deviceCycles,
+			total.waterPurified, total.waterRejected, elapsed,
+			elapsed > 0 ? (double)units * cycles / elapsed : 0.0);
+
+	freeFleet(f);
+	freeThreadPool(pool);
+	return 0;
+}
+
+
+/*
+[desc]	Tunes the default machine's thresholds and flow rates, printing a line per
+		generation, then the baseline and best candidates scored on the same
+		scenarios, and a key=value timing line.
+
+[cycles] Cycles per scenario for the survivors of each generation.
+[generations] Number of generations to run.
+[population] Candidates per generation, 0 for the default.
+[seed] Seed for the search and its scenarios.
+[threads] Worker threads for the pool, 0 for one per core.
+
+[ret]	Exit status for main.
+*/
+int runTunerBatch(long cycles, int generations, int population, uint64_t seed, int threads) {
+	TunerConfig config = tunerDefaults(generations, cycles, seed);
+	ThreadPool* pool = threadPool(threads);
+	TunerCandidate baseline = tunerBaseline();
+	TunerCandidate best;
+	double start, elapsed;
+
+	if (population > 0) {
+		config.population = population;
+		config.survivors = population < config.survivors ? population : config.survivors;
+	}
+	start = wallSeconds();
+	best = runTuner(&config, pool, 1);
+	scoreTunerCandidate(&config, pool, &baseline);
+	elapsed = wallSeconds() - start;
+
+	printTunerCandidate("baseline", &baseline);
+	printTunerCandidate("best", &best);
+	printf("generations=%d population=%d scenarios=%d threads=%d seconds=%.6f\n",
+			config.generations, config.population, config.scenarios, poolSize(pool), elapsed);
+	freeThreadPool(pool);
+	return 0;
+}
+
+
+/*
+[desc]	Runs scenario files concurrently and prints a key=value line for each, in the
+		order given, then a totals line.
+
+[paths] Scenario files to run.
+[count] Number of files.
+[threads] Worker threads for the pool, 0 for one per core.
+
+[ret]	Exit status for main, 1 if any scenario failed.
+*/
+int runScenarioBatch(char* paths[], int count, int threads) {
+	ThreadPool* pool = threadPool(threads);
+	ScenarioResult* results = (ScenarioResult*) malloc(sizeof(ScenarioResult) * count);
+	double start, elapsed;
+	long cycles = 0;
+	int i, failed;
+
+	start = wallSeconds();
+	failed = runScenarios(paths, count, pool, results);
+	elapsed = wallSeconds() - start;
+
+	for (i=0; i < count; i++) {
+		printScenarioResult(&results[i]);
+		cycles += results[i].cycles;
+	}
+	printf("scenarios=%d passed=%d failed=%d threads=%d cycles=%ld seconds=%.6f cycles_per_sec=%.0f\n",
+			count, count - failed, failed, poolSize(pool), cycles, elapsed,
+			elapsed > 0 ? cycles / elapsed : 0.0);
+	free(results);
+	freeThreadPool(pool);
+	return failed ? 1 : 0;
+}
+
+
+/*
+[desc]	Reads a trace file. Prints a summary of it, replays a range of cycles on screen,
+		or exports a range as CSV to stdout.
+
+[path] Trace file to read.
+[first] First cycle of the range.
+[last] Last cycle of the range, or -1 with no range given.
+[export] Nonzero to export CSV instead of replaying.
+
+[ret]	Exit status for main.
+*/
+int runReplay(char* path, long first, long last, int export) {
+	Trace* t = trace(path);
+	TraceState state;
+	Renderer* r;
+	Machine* m;
+	long cycle;
+
+	if (t == NULL) {
+		printf("Could not read trace %s\n", path);
+		return 1;
+	}
+	if (last < 0) {
+		first = traceFirstCycle(t);
+		last = first + traceLength(t) - 1;
+		if (!export) {
+			printf("records=%ld first_cycle=%ld last_cycle=%ld\n", traceLength(t), first, last);
+			last = first - 1; //Summary only
+		}
+	}
+	if (export) {
+		traceExport(t, first, last, stdout);
+	} else if (last >= first && traceRead(t, first, &state)) {
+		/* Replay into a default machine so it can be drawn the same way as a live run */
+		r = renderer(REPLAY_ROWS, REPLAY_COLS, REPLAY_FPS);
+		m = defaultMachine();
+		for (cycle=first; cycle <= last && traceRead(t, cycle, &state); cycle++) {
+			traceRestore(&state, m);
+			renderPace(r, REPLAY_SECONDS_PER_CYCLE);
+			if (renderDue(r) || cycle == last) {
+				printGraphics(r, m);
+				renderPrint(r, "Cycle: %ld\n\r", m->totalCycles);
+				renderFrame(r);
+			}
+		}
+		renderEnd(r);
+		freeRenderer(r);
+		freeMachine(m);
+	}
+	freeTrace(t);
+	return 0;
+}
+
+
+/*
+[desc]	Returns a monotonic wall clock reading in seconds.
+*/
+double wallSeconds(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+/*
+[desc]	Prints the command line options.
+*/
+void printUsage(char* name) {
+	printf("usage: %s [-b cycles [-i] [-p runs] [-t threads] [-w file [-x file]]]\n", name);
+	printf("       %s -m runs [-b cycles] [-s seed] [-t threads]\n", name);
+	printf("       %s -f units [-b cycles] [-s seed] [-t threads]\n", name);
+	printf("       %s -u generations [-b cycles] [-p candidates] [-s seed] [-t threads]\n", name);
+	printf("       %s -n [-t threads] files...\n", name);
+	printf("       %s -r file [-c first[:last]] [-e]\n", name);
+	printf("  -b cycles   run headless for <cycles> state-machine cycles and print a summary\n");
+	printf("  -i          infinite energy for the batch run\n");
+	printf("  -p runs     run <runs> independent machines in parallel\n");
+	printf("  -t threads  worker threads for -p and -m, defaults to one per core\n");
+	printf("  -m runs     Monte Carlo batch of <runs> randomized machines, one year each by default\n");
+	printf("  -s seed     seed for the Monte Carlo batch or fleet\n");
+	printf("  -f units    SIMD fleet of <units> randomized machines, one year each by default\n");
+	printf("  -u gens     tune thresholds and flow rates for <gens> generations, one year per scenario by default\n");
+	printf("  -n          run scenario files concurrently and check their expectations\n");
+	printf("  -o file     record every cycle of a single -b run to a trace file\n");
+	printf("  -r file     summarize a trace file\n");
+	printf("  -c range    replay cycles <first>[:<last>] of the trace on screen\n");
+	printf("  -e          export the range, or the whole trace, as CSV instead\n");
+	printf("  -w file     recharge -b runs from an hourly irradiance and temperature file\n");
+	printf("  -x file     convert the -w file to binary at <file>\n");
+}
+
+
 
-/* EOF */
\ No newline at end of file
+/* EOF */
@@ -0,0 +1,190 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	Monte Carlo scenario engine for the machine simulator.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "monteCarlo.h"
+#include "machine.h"
+#include "philox.h"
+
+
+#define DEFAULT_TURBIDITY_MIN 2.0
+#define DEFAULT_TURBIDITY_MAX 8.0
+#define DEFAULT_RECHARGE_MIN 5
+#define DEFAULT_RECHARGE_MAX 15
+#define DEFAULT_FLOW_SPREAD 0.25
+
+static const int percentiles[] = {0, 5, 25, 50, 75, 95, 100};
+#define NUM_PERCENTILES (sizeof(percentiles) / sizeof(percentiles[0]))
+
+
+//––––––  Private Types  ––––––//
+typedef struct MonteCarloJob {
+	const MonteCarloConfig* config;
+	MonteCarloResults* results;
+} MonteCarloJob;
+
+
+//––––––  Private Declarations  ––––––//
+void monteCarloRun(void* arg, int index);
+void randomizeMachine(Machine* m, const MonteCarloConfig* config, PhiloxStream* stream);
+void printPercentileRow(char name[], const long values[], int count);
+int compareLong(const void* a, const void* b);
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+MonteCarloConfig monteCarloDefaults(int runs, long cycles, uint64_t seed) {
+	MonteCarloConfig config;
+	config.runs = runs;
+	config.cycles = cycles;
+	config.seed = seed;
+	config.turbidityMin = DEFAULT_TURBIDITY_MIN;
+	config.turbidityMax = DEFAULT_TURBIDITY_MAX;
+	config.rechargeMin = DEFAULT_RECHARGE_MIN;
+	config.rechargeMax = DEFAULT_RECHARGE_MAX;
+	config.flowSpread = DEFAULT_FLOW_SPREAD;
+	return config;
+}
+
+
+MonteCarloResults* runMonteCarlo(const MonteCarloConfig* config, ThreadPool* pool) {
+	MonteCarloResults* results = (MonteCarloResults*) malloc(sizeof(MonteCarloResults));
+	MonteCarloJob job;
+
+	results->runs = config->runs;
+	results->waterPurified = (long*) calloc(config->runs, sizeof(long));
+	results->waterRejected = (long*) calloc(config->runs, sizeof(long));
+	results->idleCycles = (long*) calloc(config->runs, sizeof(long));
+
+	job.config = config;
+	job.results = results;
+	poolRun(pool, monteCarloRun, &job, config->runs);
+	return results;
+}
+
+
+Machine* monteCarloMachine(const MonteCarloConfig* config, int index) {
+	PhiloxStream stream;
+	Machine* m = defaultMachine();
+
+	philoxSeed(&stream, config->seed, (uint64_t)index);
+	randomizeMachine(m, config, &stream);
+	return m;
+}
+
+
+void printMonteCarloTable(const MonteCarloResults* results) {
+	unsigned int i;
+	printf("%-16s", "percentile");
+	for (i=0; i < NUM_PERCENTILES; i++) {
+		printf(" %11d", percentiles[i]);
+	}
+	printf("\n");
+	printPercentileRow("water_purified", results->waterPurified, results->runs);
+	printPercentileRow("water_rejected", results->waterRejected, results->runs);
+	printPercentileRow("idle_cycles", results->idleCycles, results->runs);
+}
+
+
+void freeMonteCarloResults(MonteCarloResults* results) {
+	if (results == NULL) {
+		return;
+	}
+	free(results->waterPurified);
+	free(results->waterRejected);
+	free(results->idleCycles);
+	free(results);
+}
+
+
+//––––––––––––––––––––––––––––––  Private Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]	Pool task for runMonteCarlo(). Builds, randomizes and runs a single machine,
+		then stores its results at the run's index.
+
+[arg] A MonteCarloJob.
+[index] Index of the run, also used as its Philox stream number.
+*/
+void monteCarloRun(void* arg, int index) {
+	MonteCarloJob* job = (MonteCarloJob*) arg;
+	Machine* m = monteCarloMachine(job->config, index);
+
+	runMachineHeadless(m, job->config->cycles);
+
+	job->results->waterPurified[index] = m->waterPurified;
+	job->results->waterRejected[index] = m->waterRejected;
+	job->results->idleCycles[index] = m->idleCycles;
+	freeMachine(m);
+}
+
+
+/*
+[desc]	Draws random parameters for a machine. Draws always happen in the same order
+		(turbidity, recharge, then each device) so a stream maps to one scenario.
+
+[m] The machine to randomize.
+[config] Ranges to draw from.
+[stream] The run's random stream.
+*/
+void randomizeMachine(Machine* m, const MonteCarloConfig* config, PhiloxStream* stream) {
+	int i, flow;
+	double scale;
+	float turbidity;
+
+	turbidity = config->turbidityMin + (float)philoxUniform(stream) * (config->turbidityMax - config->turbidityMin);
+	m->tanks[TANK_SOURCE]->turbidity = TURBIDITY(turbidity);
+	m->rechargePerCycle = config->rechargeMin +
+		(int)(philoxUniform(stream) * (config->rechargeMax - config->rechargeMin + 1));
+
+	for (i=0; i < m->numDevices; i++) {
+		scale = 1.0 + config->flowSpread * (2.0 * philoxUniform(stream) - 1.0);
+		if (m->devices[i] != NULL) {
+			flow = (int)(m->devices[i]->flowRate * scale + 0.5);
+			m->devices[i]->flowRate = flow < 1 ? 1 : flow;
+		}
+	}
+}
+
+
+/*
+[desc]	Prints one row of the percentile table using the nearest-rank method.
+
+[name] Row label.
+[values] Per-run values. Not modified.
+[count] Number of values.
+*/
+void printPercentileRow(char name[], const long values[], int count) {
+	long* sorted = (long*) malloc(sizeof(long) * count);
+	unsigned int i;
+	long rank;
+
+	memcpy(sorted, values, sizeof(long) * count);
+	qsort(sorted, count, sizeof(long), compareLong);
+	printf("%-16s", name);
+	for (i=0; i < NUM_PERCENTILES; i++) {
+		rank = ((long)percentiles[i] * count + 99) / 100; //ceil(p/100 * count)
+		printf(" %11ld", sorted[rank > 0 ? rank - 1 : 0]);
+	}
+	printf("\n");
+	free(sorted);
+}
+
+
+/*
+[desc]	qsort() comparator for longs.
+*/
+int compareLong(const void* a, const void* b) {
+	long x = *(const long*)a;
+	long y = *(const long*)b;
+	return (x > y) - (x < y);
+}
+
+
+/* EOF */
@@ -0,0 +1,85 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	Monte Carlo scenario engine for the machine simulator. Each run builds a
+	default machine, randomizes its source turbidity, solar recharge and device
+	flow rates, and runs it headlessly. Every run draws from its own Philox
+	stream keyed by the seed and the run index, so a batch gives the same
+	results for any thread count or run order.
+*/
+
+#ifndef MONTE_CARLO_H
+#define MONTE_CARLO_H
+
+#include <stdint.h>
+#include "threadPool.h"
+#include "machine.h"
+
+
+typedef struct MonteCarloConfig {
+	int runs;
+	long cycles; //State-machine cycles per run
+	uint64_t seed;
+	float turbidityMin; //Source turbidity range
+	float turbidityMax;
+	int rechargeMin; //Battery recharge per daytime cycle range
+	int rechargeMax;
+	float flowSpread; //Flow rates are scaled by a factor in [1 - flowSpread, 1 + flowSpread]
+} MonteCarloConfig;
+
+typedef struct MonteCarloResults {
+	int runs;
+	long* waterPurified; //Per-run results, indexed by run
+	long* waterRejected;
+	long* idleCycles;
+} MonteCarloResults;
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]	Returns a config holding the default randomization ranges, centered on the
+		values used by defaultMachine().
+
+[runs] Number of runs in the batch.
+[cycles] State-machine cycles per run.
+[seed] Seed for the batch.
+*/
+MonteCarloConfig monteCarloDefaults(int runs, long cycles, uint64_t seed);
+
+/*
+[desc]	Runs a batch of randomized machines on a thread pool. Blocks until every run
+		has finished.
+
+[config] Describes the batch.
+[pool] The thread pool to run on.
+
+[ret]	Per-run results. Free them with freeMonteCarloResults().
+*/
+MonteCarloResults* runMonteCarlo(const MonteCarloConfig* config, ThreadPool* pool);
+
+/*
+[desc]	Builds the randomized machine for one run of a batch without running it.
+
+[config] Describes the batch.
+[index] Index of the run, also used as its Philox stream number.
+
+[ret]	A pointer to the new machine. Free it with freeMachine().
+*/
+Machine* monteCarloMachine(const MonteCarloConfig* config, int index);
+
+/*
+[desc]	Prints a percentile table of water purified, water rejected and idle cycles.
+
+[results] Results from runMonteCarlo().
+*/
+void printMonteCarloTable(const MonteCarloResults* results);
+
+/*
+[desc]	Frees results returned by runMonteCarlo(). May be NULL.
+*/
+void freeMonteCarloResults(MonteCarloResults* results);
+
+
+#endif //MONTE_CARLO_H
@@ -0,0 +1,74 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	Philox4x32-10 counter-based random number generator.
+*/
+
+#include "philox.h"
+
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u //Golden ratio
+#define PHILOX_W1 0xBB67AE85u //sqrt(3) - 1
+#define PHILOX_ROUNDS 10
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+void philox4x32(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4]) {
+	uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+	uint32_t k0 = key[0], k1 = key[1];
+	uint64_t p0, p1;
+	int i;
+
+	for (i=0; i < PHILOX_ROUNDS; i++) {
+		p0 = (uint64_t)PHILOX_M0 * c0;
+		p1 = (uint64_t)PHILOX_M1 * c2;
+		c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+		c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+		c1 = (uint32_t)p1;
+		c3 = (uint32_t)p0;
+		k0 += PHILOX_W0;
+		k1 += PHILOX_W1;
+	}
+	out[0] = c0;
+	out[1] = c1;
+	out[2] = c2;
+	out[3] = c3;
+}
+
+
+void philoxSeed(PhiloxStream* stream, uint64_t seed, uint64_t id) {
+	stream->key[0] = (uint32_t)seed;
+	stream->key[1] = (uint32_t)(seed >> 32);
+	/* The low half of the counter steps through blocks, the high half names the stream */
+	stream->counter[0] = 0;
+	stream->counter[1] = 0;
+	stream->counter[2] = (uint32_t)id;
+	stream->counter[3] = (uint32_t)(id >> 32);
+	stream->used = 4;
+}
+
+
+uint32_t philoxNext(PhiloxStream* stream) {
+	if (stream->used == 4) {
+		philox4x32(stream->counter, stream->key, stream->block);
+		if (++stream->counter[0] == 0) {
+			stream->counter[1]++;
+		}
+		stream->used = 0;
+	}
+	return stream->block[stream->used++];
+}
+
+
+double philoxUniform(PhiloxStream* stream) {
+	uint64_t hi = philoxNext(stream) >> 5; //27 bits
+	uint64_t lo = philoxNext(stream) >> 6; //26 bits
+	return (double)((hi << 26) | lo) / 9007199254740992.0; //2^53
+}
+
+
+/* EOF */
@@ -0,0 +1,58 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	Philox4x32-10 counter-based random number generator (Salmon et al., "Parallel
+	Random Numbers: As Easy as 1, 2, 3"). Every output is a pure function of a key
+	and a counter, so each simulation run can own a stream keyed by the global seed
+	and numbered by its run index. A run draws the same numbers no matter which
+	thread runs it or in what order.
+*/
+
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include <stdint.h>
+
+
+typedef struct PhiloxStream {
+	uint32_t key[2];
+	uint32_t counter[4];
+	uint32_t block[4];
+	int used; //Words of block already handed out
+} PhiloxStream;
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]	Applies the ten Philox4x32 rounds to a counter block under a key.
+
+[counter] The 128-bit counter to encrypt.
+[key] The 64-bit key.
+[out] Receives four random 32-bit words.
+*/
+void philox4x32(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4]);
+
+/*
+[desc]	Initializes a stream. Streams with the same seed and id always produce the
+		same sequence, and streams with different ids never share a counter block.
+
+[stream] The stream to initialize.
+[seed] Global seed, used as the Philox key.
+[id] Stream number, for example the index of a simulation run.
+*/
+void philoxSeed(PhiloxStream* stream, uint64_t seed, uint64_t id);
+
+/*
+[desc]	Returns the next 32 random bits from a stream.
+*/
+uint32_t philoxNext(PhiloxStream* stream);
+
+/*
+[desc]	Returns a uniformly distributed double in [0, 1) with 53 bits of precision.
+*/
+double philoxUniform(PhiloxStream* stream);
+
+
+#endif //PHILOX_H
@@ -0,0 +1,231 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	Double-buffered terminal renderer for the machine simulator.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include "render.h"
+
+
+#define PRINT_BUFFER_SIZE 256
+#define MAX_CURSOR_MOVE 12 //Longest "\x1b[row;colH"
+#define RUN_GAP 4 //Unchanged cells shorter than this are resent rather than jumped over
+#define TAB_WIDTH 8
+
+#define CLEAR_SCREEN "\x1b[?25l\x1b[H\x1b[2J" //Also hides the cursor
+#define SHOW_CURSOR "\x1b[?25h"
+
+
+//––––––  Private Types  ––––––//
+struct Renderer {
+	int rows;
+	int cols;
+	char* back; //Frame being built, rows*cols
+	char* front; //Frame on screen
+	char* out; //Bytes for the next write()
+	int row; //renderPrint() cursor
+	int col;
+	int height; //Rows used by the frame on screen
+	int backHeight;
+	int started; //Screen has been cleared
+	double framePeriod;
+	double nextFrame;
+	double deadline;
+};
+
+
+//––––––  Private Declarations  ––––––//
+double monotonicSeconds(void);
+void sleepUntil(double seconds);
+void writeAll(const char* bytes, size_t count);
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+Renderer* renderer(int rows, int cols, double framesPerSecond) {
+	Renderer* r = (Renderer*) calloc(1, sizeof(Renderer));
+	r->rows = rows;
+	r->cols = cols;
+	r->back = (char*) malloc(rows * cols);
+	r->front = (char*) malloc(rows * cols);
+	r->out = (char*) malloc(sizeof(CLEAR_SCREEN) + (size_t)rows * cols * (MAX_CURSOR_MOVE + 1));
+	memset(r->back, ' ', rows * cols);
+	memset(r->front, ' ', rows * cols);
+	r->framePeriod = framesPerSecond > 0 ? 1.0 / framesPerSecond : 0;
+	r->nextFrame = 0;
+	r->deadline = monotonicSeconds();
+	return r;
+}
+
+
+void renderPrint(Renderer* r, const char* format, ...) {
+	char text[PRINT_BUFFER_SIZE];
+	va_list args;
+	int i, length;
+
+	va_start(args, format);
+	length = vsnprintf(text, sizeof(text), format, args);
+	va_end(args);
+	if (length > (int)sizeof(text) - 1) {
+		length = sizeof(text) - 1;
+	}
+
+	for (i=0; i < length; i++) {
+		if (text[i] == '\n') {
+			r->row++;
+			r->col = 0;
+		} else if (text[i] == '\r') {
+			r->col = 0;
+		} else if (text[i] == '\t') {
+			r->col += TAB_WIDTH - r->col % TAB_WIDTH;
+		} else {
+			if (r->row < r->rows && r->col < r->cols) {
+				r->back[r->row * r->cols + r->col] = text[i];
+				if (r->row >= r->backHeight) {
+					r->backHeight = r->row + 1;
+				}
+			}
+			r->col++;
+		}
+	}
+}
+
+
+int renderDue(Renderer* r) {
+	return monotonicSeconds() >= r->nextFrame;
+}
+
+
+void renderFrame(Renderer* r) {
+	char* out = r->out;
+	char* back;
+	char* front;
+	int row, col, end, gap;
+
+	if (!r->started) {
+		memcpy(out, CLEAR_SCREEN, sizeof(CLEAR_SCREEN) - 1);
+		out += sizeof(CLEAR_SCREEN) - 1;
+		r->started = 1;
+	}
+
+	for (row=0; row < r->rows; row++) {
+		back = &r->back[row * r->cols];
+		front = &r->front[row * r->cols];
+		for (col=0; col < r->cols; ) {
+			if (back[col] == front[col]) {
+				col++;
+				continue;
+			}
+			/* Extend the run of changed cells across short unchanged gaps */
+			for (end=col + 1, gap=0; end < r->cols && gap < RUN_GAP; end++) {
+				gap = back[end] == front[end] ? gap + 1 : 0;
+			}
+			end -= gap;
+			out += sprintf(out, "\x1b[%d;%dH", row + 1, col + 1);
+			memcpy(out, &back[col], end - col);
+			out += end - col;
+			col = end;
+		}
+	}
+
+	fflush(stdout); //Anything printf()'d earlier must reach the terminal first
+	writeAll(r->out, out - r->out);
+
+	memcpy(r->front, r->back, r->rows * r->cols);
+	memset(r->back, ' ', r->rows * r->cols);
+	r->height = r->backHeight;
+	r->backHeight = 0;
+	r->row = 0;
+	r->col = 0;
+	r->nextFrame = monotonicSeconds() + r->framePeriod;
+}
+
+
+void renderPace(Renderer* r, double seconds) {
+	double now = monotonicSeconds();
+	if (r->deadline < now) {
+		r->deadline = now; //Fell behind, don't try to catch up
+	}
+	r->deadline += seconds;
+	if (r->deadline > now) {
+		sleepUntil(r->deadline);
+	}
+}
+
+
+void renderEnd(Renderer* r) {
+	char move[sizeof("\x1b[-2147483648;1H" SHOW_CURSOR)]; //Room for any int row
+	int length = snprintf(move, sizeof(move), "\x1b[%d;1H" SHOW_CURSOR, r->height + 1);
+	fflush(stdout);
+	writeAll(move, length);
+}
+
+
+void freeRenderer(Renderer* r) {
+	if (r == NULL) {
+		return;
+	}
+	free(r->back);
+	free(r->front);
+	free(r->out);
+	free(r);
+}
+
+
+//––––––––––––––––––––––––––––––  Private Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]	Returns a monotonic wall clock reading in seconds.
+*/
+double monotonicSeconds(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+/*
+[desc]	Sleeps until the monotonic clock reaches a time. Unlike a busy loop on clock(),
+		the thread is idle while it waits.
+
+[seconds] A monotonicSeconds() reading to wake at.
+*/
+void sleepUntil(double seconds) {
+	struct timespec wake;
+	wake.tv_sec = (time_t)seconds;
+	wake.tv_nsec = (long)((seconds - wake.tv_sec) * 1e9);
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL) == EINTR);
+}
+
+
+/*
+[desc]	Writes a buffer to stdout, finishing any partial write.
+
+[bytes] Bytes to write.
+[count] Number of bytes.
+*/
+void writeAll(const char* bytes, size_t count) {
+	ssize_t written;
+	while (count > 0) {
+		written = write(STDOUT_FILENO, bytes, count);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return;
+		}
+		bytes += written;
+		count -= written;
+	}
+}
+
+
+/* EOF */
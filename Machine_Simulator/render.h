@@ -0,0 +1,73 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	Double-buffered terminal renderer for the machine simulator. A frame is
+	printed into a character buffer with renderPrint(), then renderFrame()
+	compares it against the frame on screen and sends only the cells that
+	changed, using ANSI cursor moves, in a single write(). renderPace() sleeps
+	to hold the simulation to a wall clock rate, and renderDue() lets the caller
+	skip drawing frames when the simulation runs faster than the display.
+*/
+
+#ifndef RENDER_H
+#define RENDER_H
+
+
+typedef struct Renderer Renderer;
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]	Constructor for a Renderer drawing to stdout. Nothing is drawn until the
+		first call to renderFrame(), which clears the screen.
+
+[rows] Height of the frame in characters. Text below it is dropped.
+[cols] Width of the frame in characters. Text right of it is dropped.
+[framesPerSecond] Most frames renderDue() allows per second.
+
+[ret]	A pointer to the new renderer.
+*/
+Renderer* renderer(int rows, int cols, double framesPerSecond);
+
+/*
+[desc]	printf() into the next frame at the renderer's cursor. '\n' moves the
+		cursor to the start of the next row and '\r' to the start of the row.
+*/
+void renderPrint(Renderer* r, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+/*
+[desc]	Returns whether enough time has passed since the last frame to draw another.
+		Callers skip building frames while it returns 0.
+*/
+int renderDue(Renderer* r);
+
+/*
+[desc]	Puts the frame built with renderPrint() on screen. Writes only the cells
+		that differ from the previous frame, then starts a new, blank frame.
+*/
+void renderFrame(Renderer* r);
+
+/*
+[desc]	Sleeps until <seconds> after the end of the previous call, so a loop calling
+		it once per step runs no faster than one step per <seconds>. If the loop
+		falls behind it carries on from now instead of rushing to catch up.
+
+[seconds] Wall time per step.
+*/
+void renderPace(Renderer* r, double seconds);
+
+/*
+[desc]	Moves the cursor below the last frame and shows it again, so normal printing
+		can continue underneath.
+*/
+void renderEnd(Renderer* r);
+
+/*
+[desc]	Frees a renderer. May be NULL.
+*/
+void freeRenderer(Renderer* r);
+
+
+#endif //RENDER_H
@@ -0,0 +1,365 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	Scripted scenarios for the machine simulator.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "scenario.h"
+#include "machine.h"
+#include "weather.h"
+
+
+#define SCENARIO_LINE_LENGTH 256
+#define SCENARIO_WORD_LENGTH 64
+#define SCENARIO_FAILURE_LENGTH (2 * SCENARIO_WORD_LENGTH + 48) //"<stat> <op> <long>, got <long>"
+
+
+//––––––  Private Types  ––––––//
+typedef struct ScenarioJob {
+	char** paths;
+	ScenarioResult* results;
+} ScenarioJob;
+
+/* Everything a scenario's commands act on */
+typedef struct ScenarioContext {
+	Machine* machine;
+	Weather* weather;
+	MachineSnapshot snapshot;
+	int haveSnapshot;
+	ScenarioResult* result;
+	int line; //Number of the line being run
+} ScenarioContext;
+
+
+//––––––  Private Declarations  ––––––//
+void scenarioJob(void* arg, int index);
+int runScenarioLine(ScenarioContext* s, char line[]);
+int setParameter(Machine* m, char parameter[], char value[]);
+int readStat(Machine* m, char stat[], long* value);
+int compareStat(long actual, char op[], long expected, int* holds);
+void scenarioMessage(ScenarioContext* s, const char* text, const char* word);
+double secondsSince(const struct timespec* start);
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+int runScenario(const char* path, ScenarioResult* result) {
+	ScenarioContext s = {};
+	char line[SCENARIO_LINE_LENGTH];
+	struct timespec start;
+	FILE* file;
+	int ok = 1;
+
+	memset(result, 0, sizeof(ScenarioResult));
+	result->path = path;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if ((file = fopen(path, "r")) == NULL) {
+		snprintf(result->message, SCENARIO_MESSAGE_LENGTH, "%s: could not open", path);
+		return 0;
+	}
+
+	s.machine = defaultMachine();
+	s.result = result;
+	while (ok && fgets(line, sizeof(line), file)) {
+		s.line++;
+		if (strchr(line, '\n') == NULL && !feof(file)) {
+			scenarioMessage(&s, "line too long", NULL);
+			ok = 0;
+			break;
+		}
+		ok = runScenarioLine(&s, line);
+	}
+	fclose(file);
+	freeMachine(s.machine);
+	freeWeather(s.weather);
+
+	result->seconds = secondsSince(&start);
+	result->passed = ok && result->failures == 0;
+	return result->passed;
+}
+
+
+int runScenarios(char* paths[], int count, ThreadPool* pool, ScenarioResult results[]) {
+	ScenarioJob job;
+	int i, failed = 0;
+
+	job.paths = paths;
+	job.results = results;
+	poolRun(pool, scenarioJob, &job, count);
+	for (i=0; i < count; i++) {
+		failed += !results[i].passed;
+	}
+	return failed;
+}
+
+
+void printScenarioResult(const ScenarioResult* result) {
+	printf("scenario=%s status=%s expects=%d failures=%d cycles=%ld seconds=%.6f cycles_per_sec=%.0f\n",
+			result->path, result->passed ? "pass" : "fail", result->expects, result->failures,
+			result->cycles, result->seconds, result->seconds > 0 ? result->cycles / result->seconds : 0.0);
+	if (!result->passed) {
+		printf("\t%s\n", result->message);
+	}
+}
+
+
+//––––––––––––––––––––––––––––––  Private Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]	Pool task for runScenarios(). Runs one scenario file.
+
+[arg] A ScenarioJob.
+[index] Index of the file.
+*/
+void scenarioJob(void* arg, int index) {
+	ScenarioJob* job = (ScenarioJob*) arg;
+	runScenario(job->paths[index], &job->results[index]);
+}
+
+
+/*
+[desc]	Runs one line of a scenario file.
+
+[s] The scenario being run.
+[line] The line, with or without its newline.
+
+[ret]	1 to carry on, 0 if the line could not be run.
+*/
+int runScenarioLine(ScenarioContext* s, char line[]) {
+	char command[SCENARIO_WORD_LENGTH] = {};
+	char word[SCENARIO_WORD_LENGTH] = {};
+	char op[SCENARIO_WORD_LENGTH] = {};
+	char value[SCENARIO_WORD_LENGTH] = {};
+	char extra[2];
+	char failure[SCENARIO_FAILURE_LENGTH];
+	char* end;
+	long cycles, actual, expected;
+	int words, holds;
+
+	words = sscanf(line, "%63s %63s %63s %63s %1s", command, word, op, value, extra);
+	if (words < 1 || command[0] == '#') {
+		return 1;
+	}
+
+	if (!strcmp(command, "set") && words == 3) {
+		if (!setParameter(s->machine, word, op)) {
+			scenarioMessage(s, "can't set", word);
+			return 0;
+		}
+	} else if (!strcmp(command, "weather") && words == 2) {
+		freeWeather(s->weather);
+		if ((s->weather = weather(word)) == NULL) {
+			scenarioMessage(s, "could not read weather from", word);
+			return 0;
+		}
+		s->machine->weather = s->weather;
+	} else if (!strcmp(command, "run") && words == 2) {
+		cycles = strtol(word, &end, 10);
+		if (*end != '\0' || cycles < 1) {
+			scenarioMessage(s, "bad cycle count", word);
+			return 0;
+		}
+		runMachineHeadless(s->machine, cycles);
+		s->result->cycles += cycles;
+	} else if (!strcmp(command, "expect") && words == 4) {
+		expected = strtol(value, &end, 10);
+		if (*end != '\0' || !readStat(s->machine, word, &actual) || !compareStat(actual, op, expected, &holds)) {
+			scenarioMessage(s, "bad expectation on", word);
+			return 0;
+		}
+		s->result->expects++;
+		if (!holds) {
+			s->result->failures++;
+			snprintf(failure, sizeof(failure), "%s %s %ld, got %ld", word, op, expected, actual);
+			scenarioMessage(s, "expected", failure);
+		}
+	} else if (!strcmp(command, "snapshot") && words == 1) {
+		snapshotMachine(s->machine, &s->snapshot);
+		s->haveSnapshot = 1;
+	} else if (!strcmp(command, "restore") && words == 1) {
+		if (!s->haveSnapshot) {
+			scenarioMessage(s, "no snapshot to restore", NULL);
+			return 0;
+		}
+		freeMachine(s->machine);
+		s->machine = restoreMachine(&s->snapshot);
+		s->machine->weather = s->weather;
+	} else if (!strcmp(command, "reset") && words == 1) {
+		freeMachine(s->machine);
+		freeWeather(s->weather);
+		s->machine = defaultMachine();
+		s->weather = NULL;
+	} else {
+		scenarioMessage(s, "can't read command", command);
+		return 0;
+	}
+	return 1;
+}
+
+
+/*
+[desc]	Changes one parameter of a default machine.
+
+[m] The machine to change.
+[parameter] Name of the parameter, see scenario.h.
+[value] New value, as text.
+
+[ret]	1 on success, 0 for an unknown parameter or a value out of range.
+*/
+int setParameter(Machine* m, char parameter[], char value[]) {
+	char* flows[DEFAULT_DEVICE_COUNT] = {
+		[DEVICE_FILTER_PUMP] = "filter_flow",
+		[DEVICE_RO_PUMP] = "ro_flow",
+		[DEVICE_UV] = "uv_flow",
+		[DEVICE_DRAIN] = "drain_flow",
+		[DEVICE_RO_REJECT] = "reject_flow",
+	};
+	Battery* b = m->mainBattery;
+	char* end;
+	double units;
+	long number;
+	int i;
+
+	if (!strcmp(parameter, "source_turbidity")) {
+		units = strtod(value, &end);
+		if (*end != '\0' || units < 0) {
+			return 0;
+		}
+		m->tanks[TANK_SOURCE]->turbidity = TURBIDITY(units);
+		return 1;
+	}
+
+	number = strtol(value, &end, 10);
+	if (*end != '\0' || number < 0 || number > INFINITE_VOLUME) {
+		return 0;
+	}
+	if (!strcmp(parameter, "battery") && number > 0) {
+		b->max = number;
+		b->remaining = b->remaining < b->max ? b->remaining : b->max;
+	} else if (!strcmp(parameter, "charge") && number <= b->max) {
+		b->remaining = number;
+	} else if (!strcmp(parameter, "recharge")) {
+		m->rechargePerCycle = number;
+	} else if (!strcmp(parameter, "infinite")) {
+		m->infiniteEnergy = number != 0;
+	} else if (!strcmp(parameter, "tank_full") && number <= 100) {
+		for (i=0; i < m->numTanks; i++) {
+			m->tanks[i]->fullThreshold = number;
+			tankThresholds(m->tanks[i]);
+		}
+	} else if (!strcmp(parameter, "tank_low") && number <= 100) {
+		for (i=0; i < m->numTanks; i++) {
+			m->tanks[i]->lowThreshold = number;
+			tankThresholds(m->tanks[i]);
+		}
+	} else if (!strcmp(parameter, "battery_low") && number <= 100) {
+		b->lowThreshold = number;
+	} else {
+		for (i=0; i < DEFAULT_DEVICE_COUNT; i++) {
+			if (!strcmp(parameter, flows[i]) && m->devices[i] != NULL) {
+				m->devices[i]->flowRate = number;
+				return 1;
+			}
+		}
+		return 0;
+	}
+	return 1;
+}
+
+
+/*
+[desc]	Reads one of the machine's statistics by the name the batch summary uses.
+
+[m] The machine to read.
+[stat] Name of the statistic, see scenario.h.
+[value] Set to the statistic's value.
+
+[ret]	1 on success, 0 for an unknown name.
+*/
+int readStat(Machine* m, char stat[], long* value) {
+	MachineStats stats = machineStats(m);
+	if (!strcmp(stat, "cycles")) {
+		*value = stats.totalCycles;
+	} else if (!strcmp(stat, "idle_cycles")) {
+		*value = stats.idleCycles;
+	} else if (!strcmp(stat, "device_cycles")) {
+		*value = stats.deviceCycles;
+	} else if (!strcmp(stat, "water_purified")) {
+		*value = stats.waterPurified;
+	} else if (!strcmp(stat, "water_rejected")) {
+		*value = stats.waterRejected;
+	} else if (!strcmp(stat, "energy_used")) {
+		*value = stats.energyUsed;
+	} else if (!strcmp(stat, "battery")) {
+		*value = stats.batteryRemaining;
+	} else {
+		return 0;
+	}
+	return 1;
+}
+
+
+/*
+[desc]	Compares a statistic with its expected value.
+
+[actual] Value of the statistic.
+[op] One of == != < <= > >=.
+[expected] Value to compare against.
+[holds] Set to 1 if the comparison is true, 0 otherwise.
+
+[ret]	1 on success, 0 for an unknown op.
+*/
+int compareStat(long actual, char op[], long expected, int* holds) {
+	if (!strcmp(op, "==")) {
+		*holds = actual == expected;
+	} else if (!strcmp(op, "!=")) {
+		*holds = actual != expected;
+	} else if (!strcmp(op, "<")) {
+		*holds = actual < expected;
+	} else if (!strcmp(op, "<=")) {
+		*holds = actual <= expected;
+	} else if (!strcmp(op, ">")) {
+		*holds = actual > expected;
+	} else if (!strcmp(op, ">=")) {
+		*holds = actual >= expected;
+	} else {
+		return 0;
+	}
+	return 1;
+}
+
+
+/*
+[desc]	Records the first failure or error of a scenario as its message, prefixed with
+		the file and line. Later ones are only counted.
+
+[s] The scenario being run.
+[text] What went wrong.
+[word] Text to follow it, such as the word that could not be read, or NULL.
+*/
+void scenarioMessage(ScenarioContext* s, const char* text, const char* word) {
+	ScenarioResult* r = s->result;
+	if (r->message[0] != '\0') {
+		return;
+	}
+	snprintf(r->message, SCENARIO_MESSAGE_LENGTH, "%s:%d: %s%s%s", r->path, s->line, text,
+			word ? " " : "", word ? word : "");
+}
+
+
+/*
+[desc]	Returns the wall time in seconds since a monotonic clock reading.
+*/
+double secondsSince(const struct timespec* start) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+
+/* EOF */
@@ -0,0 +1,94 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	Scripted, non-interactive scenarios for the machine simulator. A scenario
+	file builds a default machine, changes its parameters, runs it and checks
+	the results, one command per line. Many files can be run at once on a
+	thread pool, each with its own machine.
+
+	Commands, blank lines and lines starting with '#' are ignored:
+		set <parameter> <value>    Changes the machine, see below
+		weather <file>             Recharges from an hourly weather file, see weather.h
+		run <cycles>               Runs the machine headless
+		expect <stat> <op> <value> Checks a statistic. op is one of == != < <= > >=
+		snapshot                   Saves the machine's full state
+		restore                    Goes back to the saved state
+		reset                      Starts over with the default machine
+
+	Parameters:
+		battery, charge, recharge, infinite,
+		tank_full, tank_low, battery_low (percentages),
+		filter_flow, ro_flow, reject_flow, uv_flow, drain_flow,
+		source_turbidity (units, may have a fraction)
+
+	Statistics use the names of the batch summary, so a line of ./main.o -b output
+	can be turned into expectations:
+		cycles, idle_cycles, device_cycles, water_purified, water_rejected,
+		energy_used, battery
+
+	Example:
+		# A week of a small battery
+		set battery 500
+		run 168
+		expect water_purified > 0
+		expect battery <= 500
+
+	scenarios/example.scn is a longer example, and shows how a failure is reported.
+*/
+
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include "threadPool.h"
+
+
+#define SCENARIO_MESSAGE_LENGTH 256
+
+typedef struct ScenarioResult {
+	const char* path;
+	int passed; //1 when the file ran and every expectation held
+	int expects; //Expectations checked
+	int failures; //Expectations that did not hold
+	long cycles; //Cycles run over every run command
+	double seconds; //Wall time of the whole scenario
+	char message[SCENARIO_MESSAGE_LENGTH]; //First failure or error, empty if passed
+} ScenarioResult;
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]	Runs a single scenario file. Stops at the first line that can't be read, but
+		carries on past failed expectations so every one is counted.
+
+[path] Scenario file to run.
+[result] Filled in with how the scenario went.
+
+[ret]	1 if the scenario passed, 0 otherwise.
+*/
+int runScenario(const char* path, ScenarioResult* result);
+
+/*
+[desc]	Runs many scenario files concurrently, one task per file. Blocks until every
+		one has finished.
+
+[paths] Scenario files to run.
+[count] Number of files.
+[pool] The thread pool to run on.
+[results] Filled in for each file, in the same order.
+
+[ret]	Number of scenarios that failed.
+*/
+int runScenarios(char* paths[], int count, ThreadPool* pool, ScenarioResult results[]);
+
+/*
+[desc]	Prints a scenario's result as one line of key=value pairs, followed by its
+		message on a second line if it failed.
+
+[result] The result to print.
+*/
+void printScenarioResult(const ScenarioResult* result);
+
+
+#endif //SCENARIO_H
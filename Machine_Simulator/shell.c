@@ -7,19 +7,27 @@
 
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "shell.h"
 #include "machine.h"
+#include "trace.h"
 
 
 #define SHELL_BUFFER_SIZE 64
 #define COMMAND_LENGTH SHELL_BUFFER_SIZE/2
 #define ARGUMENT_LENGTH SHELL_BUFFER_SIZE/2
+#define FORK_DEFAULT_BRANCHES 4
+#define FORK_DEFAULT_CYCLES (24 * 365)
 
 
 char shellBuffer[SHELL_BUFFER_SIZE];
 int buffCount = 0;
 int exitFlag = 0;
+Machine* activeMachine = NULL;
+TraceWriter* activeTrace = NULL;
+MachineSnapshot savedSnapshot;
+int haveSnapshot = 0;
 
 
 
@@ -27,10 +35,19 @@ int exitFlag = 0;
 void runCommand(char command[]);
 int determineCommand(char command[]);
 void clearBuffer(void);
+void stopTrace(void);
+void forkMachine(int branches, long cycles, char parameter[], int step);
 
 
 //––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
 
+void shellInit(void) {
+	stopTrace(); //The trace belongs to the old machine's cycles
+	freeMachine(activeMachine);
+	activeMachine = defaultMachine();
+}
+
+
 int shell(char c) {
 	if(c == '_') { //Special backspace key for pros
 		shellBuffer[--buffCount] = '\0';
@@ -62,6 +79,10 @@ enum commands {
 	RESET,
 	HELLO,
 	EXIT,
+	TRACE,
+	SNAPSHOT,
+	RESTORE,
+	FORK,
 };
 
 /*
@@ -75,6 +96,7 @@ void runCommand(char command[]) {
 	int cycles;
 	float secondsPerCycle;
 	int scans;
+	int branches, step;
 	switch (determineCommand(command)) {
 		case PRINT:
 			sscanf(shellBuffer, "%*s %[^\n]", argument);
@@ -84,22 +106,22 @@ void runCommand(char command[]) {
 		case RUN:
 			scans = sscanf(shellBuffer, "%*s %d %f %s", &cycles, &secondsPerCycle, argument);
 			if (scans == 3) {
-				runMachine(cycles, secondsPerCycle, 0); //Third arg disables graphics
+				runMachine(activeMachine, cycles, secondsPerCycle, 0); //Third arg disables graphics
 			} else if (scans == 2) {
-				runMachine(cycles, secondsPerCycle, 1);
+				runMachine(activeMachine, cycles, secondsPerCycle, 1);
 			} else if (scans == 1) {
-				runMachine(cycles, 0.001, 1);
+				runMachine(activeMachine, cycles, 0.001, 1);
 			} else {
-				runMachine(200, 0.01, 1); //default run
+				runMachine(activeMachine, 200, 0.01, 1); //default run
 			}
 			break;
 
 		case TOGGLE_POWER:
-			printf("\tInfinite power toggled: %s\n\r", togglePower()? "On" : "Off");
+			printf("\tInfinite power toggled: %s\n\r", togglePower(activeMachine)? "On" : "Off");
 			break;
 
 		case RESET:
-			defaultMachineInit();
+			shellInit();
 			printf("\tMachine Reset\n\r");
 			break;
 
@@ -107,7 +129,43 @@ void runCommand(char command[]) {
 			printf("\tHey there :)\n\r");
 			break;
 
+		case SNAPSHOT:
+			snapshotMachine(activeMachine, &savedSnapshot);
+			haveSnapshot = 1;
+			printf("\tSnapshot taken at cycle %ld\n\r", savedSnapshot.totalCycles);
+			break;
+
+		case RESTORE:
+			if (!haveSnapshot) {
+				printf("\tNo snapshot to restore\n\r");
+				break;
+			}
+			stopTrace();
+			freeMachine(activeMachine);
+			activeMachine = restoreMachine(&savedSnapshot);
+			printf("\tRestored to cycle %ld\n\r", savedSnapshot.totalCycles);
+			break;
+
+		case FORK:
+			branches = FORK_DEFAULT_BRANCHES;
+			cycles = FORK_DEFAULT_CYCLES;
+			step = 0;
+			strcpy(argument, "battery");
+			sscanf(shellBuffer, "%*s %d %d %31s %d", &branches, &cycles, argument, &step);
+			forkMachine(branches, cycles, argument, step);
+			break;
+
+		case TRACE:
+			stopTrace();
+			if (sscanf(shellBuffer, "%*s %31s", argument) == 1 && strcmp(argument, "off")) {
+				activeTrace = traceWriter(argument, activeMachine);
+				activeMachine->trace = activeTrace;
+				printf("\tTracing to %s: %s\n\r", argument, activeTrace ? "On" : "Failed");
+			}
+			break;
+
 		case EXIT:
+			stopTrace();
 			exitFlag = 1;
 			break;
 
@@ -137,6 +195,14 @@ int determineCommand(char command[]) {
 		return HELLO;
 	} else if(!strcmp(command, "exit")) {
 		return EXIT;
+	} else if(!strcmp(command, "trace")) {
+		return TRACE;
+	} else if(!strcmp(command, "snapshot")) {
+		return SNAPSHOT;
+	} else if(!strcmp(command, "restore")) {
+		return RESTORE;
+	} else if(!strcmp(command, "fork")) {
+		return FORK;
 	}
 	return 0;
 }
@@ -154,3 +220,81 @@ void clearBuffer(void) {
 }
 
 
+/*
+[desc]	Detaches the shell's trace from the active machine and closes the file, if
+		one is open.
+*/
+void stopTrace(void) {
+	if (activeTrace == NULL) {
+		return;
+	}
+	printf("\tTrace closed: %ld cycles\n\r", traceWriterLength(activeTrace));
+	activeMachine->trace = NULL;
+	freeTraceWriter(activeTrace);
+	activeTrace = NULL;
+}
+
+
+/*
+[desc]	Branches what-if continuations of the machine and runs them in parallel. Each
+		branch starts from the saved snapshot, or from the active machine if no
+		snapshot was taken, with one parameter changed by a multiple of step. The
+		active machine is not touched. Prints what each branch did over the run.
+
+[branches] Number of continuations to run.
+[cycles] State-machine cycles to run each branch for.
+[parameter] "battery" to vary the battery size, "recharge" to vary the recharge
+		per daytime cycle.
+[step] Change in the parameter between branches. 0 picks a tenth of the current value.
+*/
+void forkMachine(int branches, long cycles, char parameter[], int step) {
+	MachineSnapshot base;
+	ThreadPool* pool;
+	Machine** machines;
+	Machine* m;
+	int i, varyBattery = !strcmp(parameter, "battery");
+
+	if (branches < 1 || cycles < 1 || (!varyBattery && strcmp(parameter, "recharge"))) {
+		printf("\tfork [branches] [cycles] [battery | recharge] [step]\n\r");
+		return;
+	}
+	if (haveSnapshot) {
+		base = savedSnapshot;
+	} else {
+		snapshotMachine(activeMachine, &base);
+	}
+	if (step == 0) {
+		step = (varyBattery ? base.mainBattery.max : base.rechargePerCycle) / 10;
+		step = step ? step : 1;
+	}
+
+	machines = (Machine**) malloc(sizeof(Machine*) * branches);
+	for (i=0; i < branches; i++) {
+		m = restoreMachine(&base);
+		if (varyBattery) {
+			m->mainBattery->max += i * step;
+			m->mainBattery->max = m->mainBattery->max > 0 ? m->mainBattery->max : 1;
+			if (m->mainBattery->remaining > m->mainBattery->max) {
+				m->mainBattery->remaining = m->mainBattery->max;
+			}
+		} else {
+			m->rechargePerCycle += i * step;
+			m->rechargePerCycle = m->rechargePerCycle > 0 ? m->rechargePerCycle : 0;
+		}
+		machines[i] = m;
+	}
+	pool = threadPool(0);
+	runMachinesParallel(pool, machines, branches, cycles);
+	freeThreadPool(pool);
+
+	printf("\tForked %d branches at cycle %ld, ran %ld cycles each\n\r", branches, base.totalCycles, cycles);
+	printf("\t%6s %8s %8s %10s %10s %10s\n\r", "branch", "battery", "recharge", "purified", "rejected", "idle");
+	for (i=0; i < branches; i++) {
+		m = machines[i];
+		printf("\t%6d %8d %8d %10ld %10ld %10ld\n\r", i, m->mainBattery->max, m->rechargePerCycle,
+				m->waterPurified - base.waterPurified, m->waterRejected - base.waterRejected,
+				m->idleCycles - base.idleCycles);
+		freeMachine(m);
+	}
+	free(machines);
+}
@@ -17,6 +17,12 @@
 
 //––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
 
+/*
+[desc]	Creates the machine the shell commands operate on. Call before shell(). Calling
+		it again frees the current machine and starts over with the default machine.
+*/
+void shellInit(void);
+
 /*
 [desc]	Call constantly with new bytes from stdin to use the shell. 
 		Print takes a string and prints it using a custom font.
@@ -26,6 +32,11 @@
     		print [string]
     		exit
 	    	hello
+	    	trace [file | off]	Record every cycle the machine runs to a trace file
+	    	snapshot		Save the machine's full state
+	    	restore			Go back to the saved state
+	    	fork [branches] [cycles] [battery | recharge] [step]
+	    				Run what-if branches of the saved state in parallel
 
 [arg1] A byte to be buffered and/or executed when analyzed.
 	
@@ -0,0 +1,154 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	A small fixed-size pool of POSIX worker threads. Workers pull the next
+	index from a shared counter, so long and short tasks balance themselves
+	across the pool.
+*/
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "threadPool.h"
+
+
+//––––––  Private Types  ––––––//
+struct ThreadPool {
+	pthread_t* threads;
+	int numThreads;
+	pthread_mutex_t lock;
+	pthread_cond_t workReady;
+	pthread_cond_t workDone;
+
+	PoolTask task;
+	void* arg;
+	int count;
+	int next;
+	int finished;
+	unsigned long generation;
+	int shutdown;
+};
+
+
+//––––––  Private Declarations  ––––––//
+void* poolWorker(void* arg);
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+ThreadPool* threadPool(int threads) {
+	ThreadPool* pool = (ThreadPool*) calloc(1, sizeof(ThreadPool));
+	int i;
+	if (threads <= 0) {
+		threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	if (threads <= 0) {
+		threads = 1;
+	}
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->workReady, NULL);
+	pthread_cond_init(&pool->workDone, NULL);
+	pool->threads = (pthread_t*) malloc(sizeof(pthread_t) * threads);
+	for (i=0; i < threads; i++) {
+		if (pthread_create(&pool->threads[i], NULL, poolWorker, pool)) {
+			break; //Run with however many threads could be started
+		}
+	}
+	pool->numThreads = i;
+	return pool;
+}
+
+
+void poolRun(ThreadPool* pool, PoolTask task, void* arg, int count) {
+	int i;
+	if (count <= 0) {
+		return;
+	}
+	if (pool->numThreads == 0) { //No workers could be started, run inline
+		for (i=0; i < count; i++)
+			task(arg, i);
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->task = task;
+	pool->arg = arg;
+	pool->count = count;
+	pool->next = 0;
+	pool->finished = 0;
+	pool->generation++;
+	pthread_cond_broadcast(&pool->workReady);
+	while (pool->finished < pool->count) {
+		pthread_cond_wait(&pool->workDone, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+
+int poolSize(ThreadPool* pool) {
+	return pool->numThreads;
+}
+
+
+void freeThreadPool(ThreadPool* pool) {
+	int i;
+	if (pool == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&pool->lock);
+	pool->shutdown = 1;
+	pthread_cond_broadcast(&pool->workReady);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (i=0; i < pool->numThreads; i++)
+		pthread_join(pool->threads[i], NULL);
+
+	pthread_cond_destroy(&pool->workDone);
+	pthread_cond_destroy(&pool->workReady);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->threads);
+	free(pool);
+}
+
+
+//––––––––––––––––––––––––––––––  Private Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]	Body of every worker thread. Sleeps until a new generation of work is posted,
+		then claims indexes one at a time until none are left.
+
+[arg] The ThreadPool the worker belongs to.
+*/
+void* poolWorker(void* arg) {
+	ThreadPool* pool = (ThreadPool*) arg;
+	unsigned long seen = 0;
+	int index;
+
+	pthread_mutex_lock(&pool->lock);
+	while (1) {
+		while (!pool->shutdown && pool->generation == seen) {
+			pthread_cond_wait(&pool->workReady, &pool->lock);
+		}
+		if (pool->shutdown) {
+			break;
+		}
+		seen = pool->generation;
+
+		while (pool->next < pool->count) {
+			index = pool->next++;
+			pthread_mutex_unlock(&pool->lock);
+			pool->task(pool->arg, index);
+			pthread_mutex_lock(&pool->lock);
+			if (++pool->finished == pool->count) {
+				pthread_cond_signal(&pool->workDone);
+			}
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+
+/* EOF */
@@ -0,0 +1,62 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	A small fixed-size pool of POSIX worker threads. Work is handed to the pool
+	as a task function and a count, and the workers split the indexes between
+	them. Used to run many independent machine simulations at once.
+*/
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+
+typedef struct ThreadPool ThreadPool;
+
+/*
+[desc]	Signature of a task run by the pool. Called once for each index.
+
+[arg] The argument given to poolRun().
+[index] Index of the work item, from 0 to count - 1.
+*/
+typedef void (*PoolTask)(void* arg, int index);
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]	Constructor for a ThreadPool. Starts the worker threads, which sleep until
+		work is given to them with poolRun().
+
+[threads] Number of worker threads. Pass 0 to use one thread per online core.
+
+[ret]	A pointer to the newly created pool. Free it with freeThreadPool().
+*/
+ThreadPool* threadPool(int threads);
+
+/*
+[desc]	Runs task(arg, i) for every i in [0, count) on the pool's workers. Blocks
+		until every index has finished. Only one poolRun() may be active on a pool
+		at a time.
+
+[pool] The pool to run on.
+[task] The function to run for each index.
+[arg] Argument passed through to the task.
+[count] Number of indexes to run.
+*/
+void poolRun(ThreadPool* pool, PoolTask task, void* arg, int count);
+
+/*
+[desc]	Returns the number of worker threads in a pool.
+*/
+int poolSize(ThreadPool* pool);
+
+/*
+[desc]	Stops and joins every worker thread, then frees the pool.
+
+[pool] The pool to free. May be NULL.
+*/
+void freeThreadPool(ThreadPool* pool);
+
+
+#endif //THREAD_POOL_H
@@ -0,0 +1,317 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	Binary per-cycle trace of a machine.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "trace.h"
+
+
+#define TRACE_MAGIC "WLTRACE2"
+#define TRACE_INITIAL_MAP (1 << 20) //Bytes mapped when a writer is created, doubled as needed
+
+
+//––––––  Private Types  ––––––//
+typedef struct TraceHeader {
+	char magic[8];
+	int32_t recordSize;
+	int32_t numTanks;
+	int32_t numDevices;
+	int32_t reserved;
+} TraceHeader;
+
+typedef struct RecordHead {
+	int64_t cycle;
+	int32_t batteryRemaining;
+	uint16_t enables; //Bit i set when device i is enabled
+	uint8_t machineState;
+	uint8_t daytime;
+} RecordHead;
+
+typedef struct RecordTank {
+	int32_t quantity;
+	int32_t turbidity;
+} RecordTank;
+
+struct TraceWriter {
+	int fd;
+	char* map;
+	size_t mapped;
+	size_t used;
+	TraceHeader header;
+};
+
+struct Trace {
+	int fd;
+	const char* map;
+	size_t size;
+	TraceHeader header;
+	long length;
+	long firstCycle;
+};
+
+
+//––––––  Private Declarations  ––––––//
+int growTrace(TraceWriter* w, size_t bytes);
+const char* traceRecordAt(Trace* t, long index);
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+TraceWriter* traceWriter(const char* path, Machine* m) {
+	TraceWriter* w;
+	int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		return NULL;
+	}
+	w = (TraceWriter*) calloc(1, sizeof(TraceWriter));
+	w->fd = fd;
+	memcpy(w->header.magic, TRACE_MAGIC, sizeof(w->header.magic));
+	w->header.numTanks = m->numTanks;
+	w->header.numDevices = m->numDevices;
+	w->header.recordSize = sizeof(RecordHead) + m->numTanks * sizeof(RecordTank);
+	if (!growTrace(w, TRACE_INITIAL_MAP)) {
+		close(fd);
+		free(w);
+		return NULL;
+	}
+	memcpy(w->map, &w->header, sizeof(TraceHeader));
+	w->used = sizeof(TraceHeader);
+	return w;
+}
+
+
+void traceRecord(TraceWriter* w, Machine* m) {
+	RecordHead head;
+	RecordTank tank;
+	char* record;
+	int i;
+
+	if (w->map == NULL || (w->used + w->header.recordSize > w->mapped && !growTrace(w, w->mapped * 2))) {
+		return;
+	}
+	record = w->map + w->used;
+	head.cycle = m->totalCycles;
+	head.batteryRemaining = m->mainBattery->remaining;
+	head.enables = 0;
+	for (i=0; i < w->header.numDevices; i++) {
+		if (m->devices[i] != NULL && m->devices[i]->enable) {
+			head.enables |= 1 << i;
+		}
+	}
+	head.machineState = m->machineState;
+	head.daytime = m->daytime ? 1 : 0;
+	memcpy(record, &head, sizeof(head));
+	record += sizeof(head);
+	for (i=0; i < w->header.numTanks; i++) {
+		tank.quantity = m->tanks[i]->quantity;
+		tank.turbidity = m->tanks[i]->turbidity;
+		memcpy(record, &tank, sizeof(tank));
+		record += sizeof(tank);
+	}
+	w->used += w->header.recordSize;
+}
+
+
+long traceWriterLength(TraceWriter* w) {
+	return (w->used - sizeof(TraceHeader)) / w->header.recordSize;
+}
+
+
+void freeTraceWriter(TraceWriter* w) {
+	if (w == NULL) {
+		return;
+	}
+	if (w->map != NULL) {
+		munmap(w->map, w->mapped);
+	}
+	if (ftruncate(w->fd, w->used) != 0) {
+		perror("trace");
+	}
+	close(w->fd);
+	free(w);
+}
+
+
+Trace* trace(const char* path) {
+	Trace* t;
+	struct stat info;
+	void* map;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+	if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(TraceHeader)
+			|| (map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+		close(fd);
+		return NULL;
+	}
+
+	t = (Trace*) calloc(1, sizeof(Trace));
+	t->fd = fd;
+	t->map = (const char*) map;
+	t->size = info.st_size;
+	memcpy(&t->header, t->map, sizeof(TraceHeader));
+	if (memcmp(t->header.magic, TRACE_MAGIC, sizeof(t->header.magic)) != 0
+			|| t->header.numTanks < 0 || t->header.numTanks > MAX_TANK_COUNT
+			|| t->header.numDevices < 0 || t->header.numDevices > MAX_DEVICE_COUNT
+			|| t->header.recordSize <= 0
+			|| t->header.recordSize != (int64_t) sizeof(RecordHead) + (int64_t) t->header.numTanks * (int64_t) sizeof(RecordTank)) {
+		freeTrace(t);
+		return NULL;
+	}
+	t->length = ((long) t->size - (long) sizeof(TraceHeader)) / t->header.recordSize;
+	if (t->length > 0) {
+		RecordHead head;
+		memcpy(&head, traceRecordAt(t, 0), sizeof(head));
+		t->firstCycle = head.cycle;
+	}
+	return t;
+}
+
+
+long traceLength(Trace* t) {
+	return t->length;
+}
+
+
+long traceFirstCycle(Trace* t) {
+	return t->firstCycle;
+}
+
+
+int traceRead(Trace* t, long cycle, TraceState* state) {
+	RecordHead head;
+	RecordTank tank;
+	const char* record;
+	int i;
+
+	if (cycle < t->firstCycle || cycle - t->firstCycle >= t->length) {
+		return 0;
+	}
+	record = traceRecordAt(t, cycle - t->firstCycle);
+	memcpy(&head, record, sizeof(head));
+	record += sizeof(head);
+
+	state->cycle = head.cycle;
+	state->numTanks = t->header.numTanks;
+	state->numDevices = t->header.numDevices;
+	state->batteryRemaining = head.batteryRemaining;
+	state->machineState = (MachineStates) head.machineState;
+	state->daytime = head.daytime;
+	for (i=0; i < state->numDevices; i++) {
+		state->enable[i] = (head.enables >> i) & 1;
+	}
+	for (i=0; i < state->numTanks; i++) {
+		memcpy(&tank, record, sizeof(tank));
+		record += sizeof(tank);
+		state->quantity[i] = tank.quantity;
+		state->turbidity[i] = tank.turbidity;
+	}
+	return 1;
+}
+
+
+void traceRestore(const TraceState* state, Machine* m) {
+	int i;
+	for (i=0; i < state->numTanks && i < m->numTanks; i++) {
+		m->tanks[i]->quantity = state->quantity[i];
+		m->tanks[i]->turbidity = state->turbidity[i];
+	}
+	for (i=0; i < state->numDevices && i < m->numDevices; i++) {
+		if (m->devices[i] != NULL) {
+			m->devices[i]->enable = state->enable[i];
+		}
+	}
+	m->mainBattery->remaining = state->batteryRemaining;
+	m->machineState = state->machineState;
+	m->daytime = state->daytime;
+	m->totalCycles = state->cycle;
+}
+
+
+void traceExport(Trace* t, long first, long last, FILE* out) {
+	TraceState state;
+	long cycle;
+	int i;
+
+	fprintf(out, "cycle,battery,state,daytime");
+	for (i=0; i < t->header.numTanks; i++) {
+		fprintf(out, ",quantity%d,turbidity%d", i, i);
+	}
+	for (i=0; i < t->header.numDevices; i++) {
+		fprintf(out, ",enable%d", i);
+	}
+	fprintf(out, "\n");
+
+	for (cycle=first; cycle <= last && traceRead(t, cycle, &state); cycle++) {
+		fprintf(out, "%ld,%d,%d,%d", state.cycle, state.batteryRemaining, state.machineState, state.daytime);
+		for (i=0; i < state.numTanks; i++) {
+			fprintf(out, ",%d,%.3f", state.quantity[i], (double)state.turbidity[i] / TURBIDITY_SCALE);
+		}
+		for (i=0; i < state.numDevices; i++) {
+			fprintf(out, ",%d", state.enable[i]);
+		}
+		fprintf(out, "\n");
+	}
+}
+
+
+void freeTrace(Trace* t) {
+	if (t == NULL) {
+		return;
+	}
+	munmap((void*)t->map, t->size);
+	close(t->fd);
+	free(t);
+}
+
+
+//––––––––––––––––––––––––––––––  Private Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]	Extends a writer's file and maps it again at the new size. Records already
+		written stay in place since they live in the file, not the mapping.
+
+[w] The writer to grow.
+[bytes] New size of the file and mapping.
+
+[ret]	1 on success, 0 if the file could not be extended or mapped. The writer
+		then drops any further records.
+*/
+int growTrace(TraceWriter* w, size_t bytes) {
+	void* map;
+	if (w->map != NULL) {
+		munmap(w->map, w->mapped);
+		w->map = NULL;
+	}
+	if (ftruncate(w->fd, bytes) != 0) {
+		return 0;
+	}
+	map = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, w->fd, 0);
+	if (map == MAP_FAILED) {
+		return 0;
+	}
+	w->map = (char*) map;
+	w->mapped = bytes;
+	return 1;
+}
+
+
+/*
+[desc]	Returns a pointer to a record by its index in the file.
+*/
+const char* traceRecordAt(Trace* t, long index) {
+	return t->map + sizeof(TraceHeader) + (size_t)index * t->header.recordSize;
+}
+
+
+/* EOF */
@@ -0,0 +1,132 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	Binary per-cycle trace of a machine. A TraceWriter attached to a machine
+	appends one fixed-size record after every cycle: tank quantities and
+	turbidities, battery remaining, machine state, daytime and device enables.
+	The file is written through a memory map that grows as the trace does.
+
+	A Trace maps a finished file read-only. Records hold consecutive cycles, so
+	any cycle is found in O(1) by its offset from the first one.
+
+	File layout, native byte order:
+		TraceHeader
+		record[0..n): int64 cycle, int32 battery, uint16 device enables,
+		              uint8 state, uint8 daytime,
+		              numTanks * {int32 quantity, int32 turbidity}
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include "machine.h"
+
+
+typedef struct TraceWriter TraceWriter;
+typedef struct Trace Trace;
+
+typedef struct TraceState {
+	long cycle; //totalCycles after the recorded cycle
+	int numTanks;
+	int numDevices;
+	int quantity[MAX_TANK_COUNT];
+	int turbidity[MAX_TANK_COUNT]; //Fixed-point, see TURBIDITY_SCALE
+	int enable[MAX_DEVICE_COUNT];
+	int batteryRemaining;
+	MachineStates machineState;
+	int daytime;
+} TraceState;
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]	Constructor for a TraceWriter. Creates or truncates the file. Set it as a
+		machine's trace to record every cycle the machine runs from then on.
+
+[path] File to write.
+[m] The machine to be traced. Fixes the number of tanks and devices per record.
+
+[ret]	A pointer to the new writer, or NULL if the file could not be created.
+*/
+TraceWriter* traceWriter(const char* path, Machine* m);
+
+/*
+[desc]	Appends the machine's current state to the trace. Called by the machine
+		after each cycle.
+
+[w] The writer to append to.
+[m] The machine to record.
+*/
+void traceRecord(TraceWriter* w, Machine* m);
+
+/*
+[desc]	Returns the number of records written so far.
+*/
+long traceWriterLength(TraceWriter* w);
+
+/*
+[desc]	Trims the file to the records written and closes it. Detach the writer
+		from its machine first. May be NULL.
+*/
+void freeTraceWriter(TraceWriter* w);
+
+/*
+[desc]	Constructor for a Trace. Maps a trace file for reading.
+
+[path] File to read.
+
+[ret]	A pointer to the trace, or NULL if the file is missing or not a trace.
+*/
+Trace* trace(const char* path);
+
+/*
+[desc]	Returns the number of records in a trace.
+*/
+long traceLength(Trace* t);
+
+/*
+[desc]	Returns the cycle of the first record, or 0 for an empty trace.
+*/
+long traceFirstCycle(Trace* t);
+
+/*
+[desc]	Reads the record for one cycle.
+
+[t] The trace to read.
+[cycle] Cycle to look up, between traceFirstCycle() and traceFirstCycle() + traceLength() - 1.
+[state] Filled in with the record.
+
+[ret]	1 if the cycle is in the trace, 0 otherwise.
+*/
+int traceRead(Trace* t, long cycle, TraceState* state);
+
+/*
+[desc]	Copies a recorded state into a machine, for example to draw it. The machine
+		must have the tanks and devices of the traced machine. Counters other than
+		totalCycles are not recorded and are left alone.
+
+[state] The recorded state.
+[m] The machine to overwrite.
+*/
+void traceRestore(const TraceState* state, Machine* m);
+
+/*
+[desc]	Writes a range of cycles as CSV, one row per cycle with a header row.
+
+[t] The trace to read.
+[first] First cycle to write.
+[last] Last cycle to write. Clipped to the end of the trace.
+[out] Stream to write to.
+*/
+void traceExport(Trace* t, long first, long last, FILE* out);
+
+/*
+[desc]	Unmaps and closes a trace. May be NULL.
+*/
+void freeTrace(Trace* t);
+
+
+#endif //TRACE_H
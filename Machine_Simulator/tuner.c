@@ -0,0 +1,389 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	Parallel threshold and flow rate tuner for the machine simulator.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "tuner.h"
+#include "monteCarlo.h"
+#include "philox.h"
+
+
+#define DEFAULT_POPULATION 16
+#define DEFAULT_SURVIVORS 4
+#define DEFAULT_SCENARIOS 8
+#define DEFAULT_SIGMA 0.25
+#define DEFAULT_SIGMA_DECAY 0.85
+
+static const char* paramNames[NUM_TUNER_PARAMS] = {
+	"tank_full", "tank_low", "battery_low", "filter_flow", "ro_flow", "reject_flow", "uv_flow",
+};
+
+/* Device each flow parameter sets, or -1 */
+static const int paramDevices[NUM_TUNER_PARAMS] = {
+	-1, -1, -1, DEVICE_FILTER_PUMP, DEVICE_RO_PUMP, DEVICE_RO_REJECT, DEVICE_UV,
+};
+
+
+//––––––  Private Types  ––––––//
+typedef struct TunerJob {
+	const TunerConfig* config;
+	MonteCarloConfig scenarios;
+	TunerCandidate* candidates;
+	Machine** machines; //One per candidate and scenario, candidate-major
+	int* alive; //Indexes of the candidates still running
+	long cycles; //Cycles to bring every running machine up to
+} TunerJob;
+
+
+//––––––  Private Declarations  ––––––//
+void tunerJob(TunerJob* job, const TunerConfig* config, TunerCandidate* candidates, int count);
+void freeTunerJob(TunerJob* job, int count);
+void runCandidates(TunerJob* job, ThreadPool* pool, int alive, long cycles);
+void tunerRun(void* arg, int index);
+Machine* candidateMachine(TunerJob* job, int candidate, int scenario);
+void drawCandidate(const TunerConfig* config, const double mean[], double sigma, PhiloxStream* stream, TunerCandidate* c);
+double gaussian(PhiloxStream* stream);
+void sortAlive(TunerJob* job, int alive);
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+TunerConfig tunerDefaults(int generations, long cycles, uint64_t seed) {
+	TunerConfig config;
+	TunerCandidate baseline = tunerBaseline();
+	int i;
+
+	config.generations = generations;
+	config.population = DEFAULT_POPULATION;
+	config.survivors = DEFAULT_SURVIVORS;
+	config.scenarios = DEFAULT_SCENARIOS;
+	config.cycles = cycles;
+	config.seed = seed;
+	config.sigma = DEFAULT_SIGMA;
+	config.sigmaDecay = DEFAULT_SIGMA_DECAY;
+	config.min[PARAM_TANK_FULL] = 50;
+	config.max[PARAM_TANK_FULL] = 100;
+	config.min[PARAM_TANK_LOW] = 0;
+	config.max[PARAM_TANK_LOW] = 40;
+	config.min[PARAM_BATTERY_LOW] = 5;
+	config.max[PARAM_BATTERY_LOW] = 80;
+	for (i=PARAM_FILTER_FLOW; i < NUM_TUNER_PARAMS; i++) { //Pumps from half to twice their speed
+		config.min[i] = (baseline.params[i] + 1) / 2;
+		config.max[i] = baseline.params[i] * 2;
+	}
+	return config;
+}
+
+
+TunerCandidate tunerBaseline(void) {
+	TunerCandidate c;
+	Machine* m = defaultMachine();
+	int i;
+
+	memset(&c, 0, sizeof(c));
+	c.params[PARAM_TANK_FULL] = m->tanks[TANK_FILTERED]->fullThreshold;
+	c.params[PARAM_TANK_LOW] = m->tanks[TANK_FILTERED]->lowThreshold;
+	c.params[PARAM_BATTERY_LOW] = m->mainBattery->lowThreshold;
+	for (i=0; i < NUM_TUNER_PARAMS; i++) {
+		if (paramDevices[i] >= 0) {
+			c.params[i] = m->devices[paramDevices[i]]->flowRate;
+		}
+	}
+	freeMachine(m);
+	return c;
+}
+
+
+void applyTunerParams(Machine* m, const int params[NUM_TUNER_PARAMS]) {
+	int i;
+	for (i=0; i < m->numTanks; i++) {
+		m->tanks[i]->fullThreshold = params[PARAM_TANK_FULL];
+		m->tanks[i]->lowThreshold = params[PARAM_TANK_LOW];
+		tankThresholds(m->tanks[i]);
+	}
+	m->mainBattery->lowThreshold = params[PARAM_BATTERY_LOW];
+	for (i=0; i < NUM_TUNER_PARAMS; i++) {
+		if (paramDevices[i] >= 0) {
+			m->devices[paramDevices[i]]->flowRate = params[i];
+		}
+	}
+}
+
+
+void scoreTunerCandidate(const TunerConfig* config, ThreadPool* pool, TunerCandidate* candidate) {
+	TunerJob job;
+	tunerJob(&job, config, candidate, 1);
+	runCandidates(&job, pool, 1, config->cycles);
+	freeTunerJob(&job, 1);
+}
+
+
+TunerCandidate runTuner(const TunerConfig* config, ThreadPool* pool, int verbose) {
+	TunerCandidate* candidates = (TunerCandidate*) malloc(sizeof(TunerCandidate) * config->population);
+	TunerCandidate best = tunerBaseline();
+	TunerJob job;
+	PhiloxStream stream;
+	double mean[NUM_TUNER_PARAMS];
+	double sigma = config->sigma;
+	long cycles;
+	int generation, alive, rungs, keep, i, p;
+
+	for (i=0; i < NUM_TUNER_PARAMS; i++) {
+		mean[i] = best.params[i];
+	}
+	best.score = -1;
+	/* Halve until the survivors are left, the last rung runs the full cycles */
+	for (rungs=1; (config->population >> rungs) >= config->survivors && (config->population >> rungs) > 0; rungs++);
+
+	for (generation=0; generation < config->generations; generation++) {
+		for (i=0; i < config->population; i++) {
+			philoxSeed(&stream, config->seed, (uint64_t)generation * config->population + i);
+			drawCandidate(config, mean, i == 0 ? 0.0 : sigma, &stream, &candidates[i]); //Slot 0 is the mean itself
+		}
+		tunerJob(&job, config, candidates, config->population);
+
+		alive = config->population;
+		for (i=rungs - 1; i >= 0; i--) {
+			cycles = config->cycles >> i;
+			if (cycles < CYCLES_PER_DAY) {
+				cycles = config->cycles < CYCLES_PER_DAY ? config->cycles : CYCLES_PER_DAY;
+			}
+			runCandidates(&job, pool, alive, cycles);
+			sortAlive(&job, alive);
+			keep = alive / 2 > config->survivors ? alive / 2 : config->survivors;
+			alive = i > 0 && keep < alive ? keep : alive;
+		}
+		alive = alive < config->survivors ? alive : config->survivors;
+
+		/* Survivors all ran the full cycles, so their scores compare with the best */
+		if (candidates[job.alive[0]].score > best.score) {
+			best = candidates[job.alive[0]];
+		}
+		for (p=0; p < NUM_TUNER_PARAMS; p++) {
+			mean[p] = 0;
+			for (i=0; i < alive; i++) {
+				mean[p] += candidates[job.alive[i]].params[p];
+			}
+			mean[p] /= alive;
+		}
+		if (verbose) {
+			printf("generation=%d sigma=%.4f generation_best=%.6f ", generation, sigma, candidates[job.alive[0]].score);
+			printTunerCandidate("best", &best);
+		}
+		freeTunerJob(&job, config->population);
+		sigma *= config->sigmaDecay;
+	}
+	free(candidates);
+	return best;
+}
+
+
+void printTunerCandidate(const char* label, const TunerCandidate* candidate) {
+	int i;
+	printf("%s score=%.6f water_purified=%ld energy_used=%ld", label, candidate->score,
+			candidate->waterPurified, candidate->energyUsed);
+	for (i=0; i < NUM_TUNER_PARAMS; i++) {
+		printf(" %s=%d", paramNames[i], candidate->params[i]);
+	}
+	printf("\n");
+}
+
+
+//––––––––––––––––––––––––––––––  Private Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]	Sets up a job to run a set of candidates on every scenario. Machines are
+		built by the pool tasks on first use.
+
+[job] The job to set up.
+[config] Describes the scenarios.
+[candidates] Candidates to run.
+[count] Number of candidates.
+*/
+void tunerJob(TunerJob* job, const TunerConfig* config, TunerCandidate* candidates, int count) {
+	int i;
+	job->config = config;
+	job->scenarios = monteCarloDefaults(config->scenarios, config->cycles, config->seed);
+	job->candidates = candidates;
+	job->machines = (Machine**) calloc((size_t)count * config->scenarios, sizeof(Machine*));
+	job->alive = (int*) malloc(sizeof(int) * count);
+	for (i=0; i < count; i++) {
+		job->alive[i] = i;
+	}
+	job->cycles = 0;
+}
+
+
+/*
+[desc]	Frees a job's machines and bookkeeping, but not its candidates.
+
+[job] The job to free.
+[count] Number of candidates it was set up with.
+*/
+void freeTunerJob(TunerJob* job, int count) {
+	int i;
+	for (i=0; i < count * job->config->scenarios; i++) {
+		freeMachine(job->machines[i]);
+	}
+	free(job->machines);
+	free(job->alive);
+}
+
+
+/*
+[desc]	Runs the first candidates in a job's alive list up to a number of cycles on
+		every scenario, in parallel, then scores them.
+
+[job] The job to run.
+[pool] The thread pool to run on.
+[alive] Number of candidates from the alive list to run.
+[cycles] Cycles each of their machines should have run once done.
+*/
+void runCandidates(TunerJob* job, ThreadPool* pool, int alive, long cycles) {
+	TunerCandidate* c;
+	Machine* m;
+	int i, s;
+
+	job->cycles = cycles;
+	poolRun(pool, tunerRun, job, alive * job->config->scenarios);
+
+	for (i=0; i < alive; i++) {
+		c = &job->candidates[job->alive[i]];
+		c->cycles = cycles;
+		c->waterPurified = 0;
+		c->energyUsed = 0;
+		for (s=0; s < job->config->scenarios; s++) {
+			m = job->machines[job->alive[i] * job->config->scenarios + s];
+			c->waterPurified += m->waterPurified;
+			c->energyUsed += m->energyUsed;
+		}
+		c->score = c->energyUsed > 0 ? (double)c->waterPurified / c->energyUsed : 0.0;
+	}
+}
+
+
+/*
+[desc]	Pool task for runCandidates(). Runs one candidate on one scenario, carrying on
+		from wherever the machine stopped in the last rung.
+
+[arg] A TunerJob.
+[index] Position in the alive list times the number of scenarios, plus the scenario.
+*/
+void tunerRun(void* arg, int index) {
+	TunerJob* job = (TunerJob*) arg;
+	int candidate = job->alive[index / job->config->scenarios];
+	int scenario = index % job->config->scenarios;
+	Machine** slot = &job->machines[candidate * job->config->scenarios + scenario];
+
+	if (*slot == NULL) {
+		*slot = candidateMachine(job, candidate, scenario);
+	}
+	if ((*slot)->totalCycles < job->cycles) {
+		runMachineHeadless(*slot, job->cycles - (*slot)->totalCycles);
+	}
+}
+
+
+/*
+[desc]	Builds a scenario's Monte Carlo machine with a candidate's parameters. Flow
+		rates keep the scenario's spread: a pump the scenario runs 10% fast runs 10%
+		faster than the candidate's rate.
+
+[job] The job the candidate belongs to.
+[candidate] Index of the candidate.
+[scenario] Index of the scenario, its Monte Carlo run index.
+
+[ret]	A pointer to the new machine. Free it with freeMachine().
+*/
+Machine* candidateMachine(TunerJob* job, int candidate, int scenario) {
+	Machine* m = monteCarloMachine(&job->scenarios, scenario);
+	Machine* base = defaultMachine();
+	int params[NUM_TUNER_PARAMS];
+	int i, d, flow;
+
+	memcpy(params, job->candidates[candidate].params, sizeof(params));
+	for (i=0; i < NUM_TUNER_PARAMS; i++) {
+		d = paramDevices[i];
+		if (d >= 0) {
+			flow = (int)((double)params[i] * m->devices[d]->flowRate / base->devices[d]->flowRate + 0.5);
+			params[i] = flow < 1 ? 1 : flow;
+		}
+	}
+	applyTunerParams(m, params);
+	freeMachine(base);
+	return m;
+}
+
+
+/*
+[desc]	Draws a candidate from a normal distribution around the mean, rounded and
+		clipped to the search range. Tanks are kept able to be neither full nor empty.
+
+[config] Holds the search range.
+[mean] Center of the distribution, one per parameter.
+[sigma] Standard deviation as a fraction of each range.
+[stream] The candidate's random stream.
+[c] Filled in with the new, unscored candidate.
+*/
+void drawCandidate(const TunerConfig* config, const double mean[], double sigma, PhiloxStream* stream, TunerCandidate* c) {
+	double value;
+	int i;
+
+	memset(c, 0, sizeof(TunerCandidate));
+	for (i=0; i < NUM_TUNER_PARAMS; i++) {
+		value = mean[i] + sigma * (config->max[i] - config->min[i]) * gaussian(stream);
+		value = floor(value + 0.5);
+		if (value < config->min[i]) {
+			value = config->min[i];
+		} else if (value > config->max[i]) {
+			value = config->max[i];
+		}
+		c->params[i] = (int)value;
+	}
+	if (c->params[PARAM_TANK_LOW] >= c->params[PARAM_TANK_FULL]) {
+		c->params[PARAM_TANK_LOW] = c->params[PARAM_TANK_FULL] - 1;
+	}
+}
+
+
+/*
+[desc]	Returns a standard normal draw using the Box-Muller transform.
+*/
+double gaussian(PhiloxStream* stream) {
+	double u = 1.0 - philoxUniform(stream); //(0, 1], so the log is finite
+	double v = philoxUniform(stream);
+	return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+
+/*
+[desc]	Sorts the first entries of a job's alive list by score, best first. Ties go
+		to the lower index so the order never depends on the sort.
+
+[job] The job to sort.
+[alive] Number of entries to sort.
+*/
+void sortAlive(TunerJob* job, int alive) {
+	int i, j, a, b;
+	for (i=1; i < alive; i++) { //Insertion sort, populations are small
+		a = job->alive[i];
+		for (j=i; j > 0; j--) {
+			b = job->alive[j - 1];
+			if (job->candidates[b].score > job->candidates[a].score
+					|| (job->candidates[b].score == job->candidates[a].score && b < a)) {
+				break;
+			}
+			job->alive[j] = b;
+		}
+		job->alive[j] = a;
+	}
+}
+
+
+/* EOF */
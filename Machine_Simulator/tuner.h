@@ -0,0 +1,118 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	Parallel tuner for the default machine's control thresholds and flow rates.
+	Searches for the settings that purify the most water per unit of energy used,
+	scored over a fixed set of Monte Carlo scenarios.
+
+	Each generation of the evolution strategy draws a population of candidates
+	around the current mean, then narrows it down by successive halving: all
+	candidates run a short stretch, the better half keeps running for twice as
+	long, and so on until the survivors reach the full number of cycles. Bad
+	candidates stop early, so most of the time goes to good ones. Machines carry
+	on from where they stopped rather than starting over. The mean moves to the
+	survivors and the step size shrinks.
+
+	Every candidate is drawn from a Philox stream numbered by its generation and
+	slot, and every scenario is the same Monte Carlo run for all candidates, so
+	a seed gives the same result for any thread count.
+*/
+
+#ifndef TUNER_H
+#define TUNER_H
+
+#include <stdint.h>
+#include "threadPool.h"
+#include "machine.h"
+
+
+/* Tuned parameters, all integers */
+typedef enum {
+	PARAM_TANK_FULL, //Tank fullThreshold, percent
+	PARAM_TANK_LOW, //Tank lowThreshold, percent
+	PARAM_BATTERY_LOW, //Battery lowThreshold, percent
+	PARAM_FILTER_FLOW,
+	PARAM_RO_FLOW,
+	PARAM_REJECT_FLOW,
+	PARAM_UV_FLOW,
+	NUM_TUNER_PARAMS,
+} TunerParams;
+
+typedef struct TunerConfig {
+	int generations;
+	int population; //Candidates drawn per generation
+	int survivors; //Candidates that reach the full number of cycles
+	int scenarios; //Monte Carlo scenarios every candidate is scored on
+	long cycles; //Cycles per scenario for the survivors
+	uint64_t seed;
+	int min[NUM_TUNER_PARAMS]; //Search range, inclusive
+	int max[NUM_TUNER_PARAMS];
+	double sigma; //First step size as a fraction of each range
+	double sigmaDecay; //Step size is scaled by this every generation
+} TunerConfig;
+
+typedef struct TunerCandidate {
+	int params[NUM_TUNER_PARAMS];
+	long cycles; //Cycles per scenario the scores cover
+	long waterPurified; //Summed over the scenarios
+	long energyUsed;
+	double score; //waterPurified / energyUsed
+} TunerCandidate;
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]	Returns a config with the default population and search ranges. The ranges
+		are centered on the values used by defaultMachine().
+
+[generations] Number of generations to run.
+[cycles] Cycles per scenario for the survivors of each generation.
+[seed] Seed for the search and its scenarios.
+*/
+TunerConfig tunerDefaults(int generations, long cycles, uint64_t seed);
+
+/*
+[desc]	Returns the parameters of defaultMachine(), not yet scored.
+*/
+TunerCandidate tunerBaseline(void);
+
+/*
+[desc]	Sets a machine's thresholds and flow rates from a candidate's parameters.
+
+[m] A default machine to change.
+[params] Parameters, indexed by TunerParams.
+*/
+void applyTunerParams(Machine* m, const int params[NUM_TUNER_PARAMS]);
+
+/*
+[desc]	Scores a single candidate on every scenario at the full number of cycles.
+
+[config] Describes the scenarios.
+[pool] The thread pool to run on.
+[candidate] Parameters to score. Its results are filled in.
+*/
+void scoreTunerCandidate(const TunerConfig* config, ThreadPool* pool, TunerCandidate* candidate);
+
+/*
+[desc]	Runs the search. Blocks until every generation has finished.
+
+[config] Describes the search.
+[pool] The thread pool to run on.
+[verbose] Nonzero to print a line per generation.
+
+[ret]	The best candidate scored at the full number of cycles.
+*/
+TunerCandidate runTuner(const TunerConfig* config, ThreadPool* pool, int verbose);
+
+/*
+[desc]	Prints a candidate as one line of key=value pairs.
+
+[label] Printed first, for example "best".
+[candidate] The candidate to print.
+*/
+void printTunerCandidate(const char* label, const TunerCandidate* candidate);
+
+
+#endif //TUNER_H
@@ -0,0 +1,324 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	Memory mapped hourly weather for the machine simulator.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "weather.h"
+
+
+#define WEATHER_MAGIC "WLWTHR1"
+#define INITIAL_INDEX_SIZE 1024
+
+
+//––––––  Private Types  ––––––//
+typedef struct WeatherHeader {
+	char magic[8];
+	int32_t recordSize;
+	int32_t reserved;
+	int64_t count;
+} WeatherHeader;
+
+struct Weather {
+	int fd;
+	const char* map;
+	size_t size;
+	long length;
+	int binary;
+	size_t* index; //CSV only: offset of every WEATHER_INDEX_STRIDE'th hour
+	long cursorHour; //CSV only: hour found at cursor, -1 when unset
+	size_t cursor;
+};
+
+
+//––––––  Private Declarations  ––––––//
+int indexCsv(Weather* w);
+const char* findHour(Weather* w, const char* p, WeatherSample* sample, const char** next);
+int parseHour(const char* line, const char* end, WeatherSample* sample);
+int parseNumber(const char* p, const char* end, float* value);
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+Weather* weather(const char* path) {
+	Weather* w;
+	WeatherHeader header;
+	struct stat info;
+	void* map;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+	if (fstat(fd, &info) != 0 || info.st_size == 0
+			|| (map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+		close(fd);
+		return NULL;
+	}
+	madvise(map, info.st_size, MADV_SEQUENTIAL); //Cycles read hours in order
+
+	w = (Weather*) calloc(1, sizeof(Weather));
+	w->fd = fd;
+	w->map = (const char*) map;
+	w->size = info.st_size;
+	w->cursorHour = -1;
+	if (w->size >= sizeof(WeatherHeader) && memcmp(w->map, WEATHER_MAGIC, sizeof(WEATHER_MAGIC)) == 0) {
+		memcpy(&header, w->map, sizeof(header));
+		w->binary = 1;
+		w->length = header.count;
+		if (header.recordSize != sizeof(WeatherSample)
+				|| header.count > (int64_t)((w->size - sizeof(WeatherHeader)) / sizeof(WeatherSample))) {
+			w->length = 0;
+		}
+	} else if (!indexCsv(w)) {
+		w->length = 0;
+	}
+	if (w->length <= 0) {
+		freeWeather(w);
+		return NULL;
+	}
+	return w;
+}
+
+
+long weatherLength(Weather* w) {
+	return w->length;
+}
+
+
+int weatherRead(Weather* w, long hour, WeatherSample* sample) {
+	const char* p;
+	const char* next;
+	long skip;
+
+	if (hour < 0 || hour >= w->length) {
+		return 0;
+	}
+	if (w->binary) {
+		memcpy(sample, w->map + sizeof(WeatherHeader) + (size_t)hour * sizeof(WeatherSample), sizeof(WeatherSample));
+		return 1;
+	}
+
+	/* Scan forward from the cursor when it is close behind, otherwise from the index */
+	if (w->cursorHour >= 0 && hour >= w->cursorHour && hour - w->cursorHour < WEATHER_INDEX_STRIDE) {
+		p = w->map + w->cursor;
+		skip = hour - w->cursorHour;
+	} else {
+		p = w->map + w->index[hour / WEATHER_INDEX_STRIDE];
+		skip = hour % WEATHER_INDEX_STRIDE;
+	}
+	for (skip++; skip > 0; skip--) {
+		p = findHour(w, p, sample, &next);
+		if (p == NULL) {
+			return 0;
+		}
+		p = next;
+	}
+	w->cursorHour = hour + 1;
+	w->cursor = next - w->map;
+	return 1;
+}
+
+
+int weatherRecharge(Weather* w, long cycle, int peakRecharge) {
+	WeatherSample sample;
+	double derate, energy;
+	if (!weatherRead(w, cycle % w->length, &sample) || sample.irradiance <= 0) {
+		return 0;
+	}
+	derate = 1.0 - PANEL_TEMPERATURE_COEFFICIENT * (sample.temperature - STANDARD_TEMPERATURE);
+	energy = peakRecharge * sample.irradiance / STANDARD_IRRADIANCE * derate;
+	return energy > 0 ? (int)(energy + 0.5) : 0;
+}
+
+
+int weatherWriteBinary(Weather* w, const char* path) {
+	WeatherHeader header = {};
+	WeatherSample sample;
+	FILE* out = fopen(path, "wb");
+	long hour;
+	int ok;
+
+	if (out == NULL) {
+		return 0;
+	}
+	memcpy(header.magic, WEATHER_MAGIC, sizeof(WEATHER_MAGIC));
+	header.recordSize = sizeof(WeatherSample);
+	header.count = w->length;
+	ok = fwrite(&header, sizeof(header), 1, out) == 1;
+	for (hour=0; ok && hour < w->length; hour++) {
+		ok = weatherRead(w, hour, &sample) && fwrite(&sample, sizeof(sample), 1, out) == 1;
+	}
+	return fclose(out) == 0 && ok;
+}
+
+
+void freeWeather(Weather* w) {
+	if (w == NULL) {
+		return;
+	}
+	munmap((void*)w->map, w->size);
+	close(w->fd);
+	free(w->index);
+	free(w);
+}
+
+
+//––––––––––––––––––––––––––––––  Private Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]	Scans a CSV file once, counting its hours and recording where every
+		WEATHER_INDEX_STRIDE'th one starts.
+
+[w] The weather to index.
+
+[ret]	1 on success, 0 if the index could not be allocated.
+*/
+int indexCsv(Weather* w) {
+	WeatherSample sample;
+	const char* p = w->map;
+	const char* next;
+	size_t* grown;
+	long capacity = INITIAL_INDEX_SIZE;
+
+	w->index = (size_t*) malloc(capacity * sizeof(size_t));
+	if (w->index == NULL) {
+		return 0;
+	}
+	for (w->length=0; (p = findHour(w, p, &sample, &next)) != NULL; w->length++, p = next) {
+		if (w->length % WEATHER_INDEX_STRIDE != 0) {
+			continue;
+		}
+		if (w->length / WEATHER_INDEX_STRIDE == capacity) {
+			capacity *= 2;
+			grown = (size_t*) realloc(w->index, capacity * sizeof(size_t));
+			if (grown == NULL) {
+				return 0;
+			}
+			w->index = grown;
+		}
+		w->index[w->length / WEATHER_INDEX_STRIDE] = p - w->map;
+	}
+	return 1;
+}
+
+
+/*
+[desc]	Finds the next line of a CSV file holding an hour of weather, skipping any
+		that don't.
+
+[w] The weather being read.
+[p] Start of the line to search from.
+[sample] Filled in with the hour found.
+[next] Set to the start of the line after it.
+
+[ret]	Start of the line found, or NULL at the end of the file.
+*/
+const char* findHour(Weather* w, const char* p, WeatherSample* sample, const char** next) {
+	const char* end = w->map + w->size;
+	const char* eol;
+	while (p < end) {
+		eol = (const char*) memchr(p, '\n', end - p);
+		if (eol == NULL) {
+			eol = end;
+		}
+		if (parseHour(p, eol, sample)) {
+			*next = eol < end ? eol + 1 : end;
+			return p;
+		}
+		p = eol + 1;
+	}
+	return NULL;
+}
+
+
+/*
+[desc]	Reads the irradiance and temperature from the last two fields of a CSV line.
+
+[line] Start of the line.
+[end] End of the line, excluding the newline.
+[sample] Filled in on success.
+
+[ret]	1 if both fields are numbers, 0 otherwise.
+*/
+int parseHour(const char* line, const char* end, WeatherSample* sample) {
+	const char* split;
+	const char* start;
+
+	if (end > line && end[-1] == '\r') {
+		end--;
+	}
+	for (split=end; split > line && split[-1] != ','; split--);
+	if (split == line) {
+		return 0; //No comma
+	}
+	split--;
+	for (start=split; start > line && start[-1] != ','; start--); //The line itself when there are only two fields
+	return parseNumber(start, split, &sample->irradiance) && parseNumber(split + 1, end, &sample->temperature);
+}
+
+
+/*
+[desc]	Parses a decimal number filling a whole field, with optional surrounding
+		spaces, sign, fraction and exponent. Works on the mapped file directly, which
+		is not null terminated, so strtod() can't be used.
+
+[p] Start of the field.
+[end] End of the field.
+[value] Set to the number on success.
+
+[ret]	1 if the field is a number, 0 otherwise.
+*/
+int parseNumber(const char* p, const char* end, float* value) {
+	double number = 0, scale = 1;
+	int negative = 0, digits = 0, exponent = 0, exponentNegative = 0;
+
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '"')) p++;
+	while (end > p && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '"')) end--;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = *p++ == '-';
+	}
+	for (; p < end && *p >= '0' && *p <= '9'; p++, digits++) {
+		number = number * 10 + (*p - '0');
+	}
+	if (p < end && *p == '.') {
+		for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits++) {
+			scale /= 10;
+			number += (*p - '0') * scale;
+		}
+	}
+	if (digits == 0) {
+		return 0;
+	}
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		p++;
+		if (p < end && (*p == '-' || *p == '+')) {
+			exponentNegative = *p++ == '-';
+		}
+		if (p == end) {
+			return 0;
+		}
+		for (; p < end && *p >= '0' && *p <= '9'; p++) {
+			exponent = exponent < 1000 ? exponent * 10 + (*p - '0') : exponent;
+		}
+		for (; exponent > 0; exponent--) {
+			number = exponentNegative ? number / 10 : number * 10;
+		}
+	}
+	if (p != end) {
+		return 0;
+	}
+	*value = (float)(negative ? -number : number);
+	return 1;
+}
+
+
+/* EOF */
@@ -0,0 +1,103 @@
+/*
+	Carl Lindquist
+	Oct 17, 2026
+
+	Hourly solar irradiance and air temperature for driving a machine's battery
+	recharge from real weather. Files are memory mapped and read in place, so
+	multi-year datasets are streamed from the page cache rather than loaded.
+
+	Two formats are read, told apart by the first bytes of the file:
+
+	CSV, one hour per line. The last two fields of a line are the irradiance in
+	W/m^2 and the temperature in degrees C. Earlier fields, such as a timestamp,
+	are ignored, and lines whose last two fields are not numbers (headers,
+	comments) are skipped. Opening a CSV file scans it once to build a sparse
+	index of every WEATHER_INDEX_STRIDE'th line, so any hour is found by a short
+	scan from the nearest index entry, and consecutive hours in O(1).
+
+	Binary, native byte order:
+		char magic[8] "WLWTHR1", int32 record size, int32 reserved, int64 count
+		record[0..count): float irradiance, float temperature
+	Any hour is found in O(1). weatherWriteBinary() converts from CSV.
+
+	A Weather keeps a read cursor, so give each thread its own. Opening the same
+	file several times shares its pages.
+*/
+
+#ifndef WEATHER_H
+#define WEATHER_H
+
+
+#define WEATHER_INDEX_STRIDE 64
+#define STANDARD_IRRADIANCE 1000.0 //W/m^2 at which a panel makes its rated power
+#define STANDARD_TEMPERATURE 25.0 //Degrees C at which a panel makes its rated power
+#define PANEL_TEMPERATURE_COEFFICIENT 0.004 //Fraction of power lost per degree above standard
+
+
+typedef struct Weather Weather;
+
+typedef struct WeatherSample {
+	float irradiance; //W/m^2
+	float temperature; //Degrees C
+} WeatherSample;
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]	Constructor for a Weather. Maps a CSV or binary weather file for reading.
+
+[path] File to read.
+
+[ret]	A pointer to the weather, or NULL if the file is missing, malformed or has
+		no hours in it.
+*/
+Weather* weather(const char* path);
+
+/*
+[desc]	Returns the number of hours in a weather file.
+*/
+long weatherLength(Weather* w);
+
+/*
+[desc]	Reads one hour of weather.
+
+[w] The weather to read.
+[hour] Hour to read, from 0 to weatherLength() - 1.
+[sample] Filled in with the hour's weather.
+
+[ret]	1 if the hour is in the file, 0 otherwise.
+*/
+int weatherRead(Weather* w, long hour, WeatherSample* sample);
+
+/*
+[desc]	Returns the energy a machine's panels deliver in one cycle. Scales with
+		irradiance and drops as the panels heat above the standard temperature.
+		Cycles past the end of the data wrap around to the start.
+
+[w] The weather to read.
+[cycle] Machine cycle, one hour each.
+[peakRecharge] Energy per cycle at standard irradiance and temperature.
+
+[ret]	Energy to add to the battery, never negative.
+*/
+int weatherRecharge(Weather* w, long cycle, int peakRecharge);
+
+/*
+[desc]	Writes a weather's hours to a binary weather file, which opens and seeks
+		faster than CSV.
+
+[w] The weather to convert.
+[path] File to create or truncate.
+
+[ret]	1 on success, 0 if the file could not be written.
+*/
+int weatherWriteBinary(Weather* w, const char* path);
+
+/*
+[desc]	Unmaps and closes a weather file. Detach it from any machine first. May be NULL.
+*/
+void freeWeather(Weather* w);
+
+
+#endif //WEATHER_H
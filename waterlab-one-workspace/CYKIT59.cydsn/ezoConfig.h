@@ -0,0 +1,20 @@
+/*
+    Carl Lindquist
+    Oct 17, 2026
+
+    EZO circuits of the Waterlab One, for the EZO library. See ezoProtocol.h.
+*/
+
+#ifndef EZO_CONFIG_H
+#define EZO_CONFIG_H
+
+
+#define EC_SENSOR_ADDRESS 100
+#define DO_SENSOR_ADDRESS 97
+
+#define EZO_SENSORS(EZO_SENSOR) \
+    EZO_SENSOR(EC_SENSOR_ADDRESS, EZO_TYPE_EC, "R", 1000, I2C_PRIORITY_SAFETY) \
+    EZO_SENSOR(DO_SENSOR_ADDRESS, EZO_TYPE_DO, "R", 1000, I2C_PRIORITY_BACKGROUND)
+
+
+#endif /* EZO_CONFIG_H */
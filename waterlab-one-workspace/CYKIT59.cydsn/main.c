@@ -51,12 +51,18 @@ enum POWER_MODES {
 
 uint8 recirculate;
 int32 dutyCycle;
+uint32 tankEmptiedAt[MAX_TANK_COUNT]; /* Timestamp of each tank's last empty event */
+uint8 tankEmptiedAtValid[MAX_TANK_COUNT]; /* Whether tankEmptiedAt holds an empty event not yet matched by a full one */
+uint32 tankFillTime[MAX_TANK_COUNT]; /* Milliseconds from each tank's last empty event to its next full event */
+uint32 heldTankEvents; /* Events taken by pollWhileWaiting(), handed on by the next drainTankEvents() */
 
 //––––––  Private Declarations  ––––––//
 CY_ISR_PROTO(Watchdog_ISR);
 CY_ISR_PROTO(Recirculate_Isr);
 
 uint8 getDutyCycle(uint8 potIndex);
+uint32 drainTankEvents(void);
+void pollWhileWaiting(uint32 milliseconds);
 void runHighPower(void);
 void runMidPower(void);
 void midPowerInit(void);
@@ -93,6 +99,7 @@ int main(void) {
     
     char outstring[30] = {};
     while(1) {
+        tstarRun(); /* Readings only update while tstarRun() is called */
         if (!SW1_Pin_Read()) {
             sprintf(outstring, "Voltage: %f", tstarBattVolt());
             usbLog("Main",outstring);
@@ -122,6 +129,8 @@ int main(void) {
     double battVoltage;
     double panelCurrent;
     while(TRUE) {
+        ezoRun();
+        tstarRun();
         battVoltage = tstarBattVolt();
         panelCurrent = tstarPVCurrent();
         switch (powerMode) {
@@ -157,6 +166,7 @@ int main(void) {
                 }
                 break;
         }
+        ezoSetProcessActive(Pump0_En_Read() || Pump1_En_Read() || Pump2_En_Read()); /* Idle plants are sampled less */
 
         
         /* In case you find an undefined state! */
@@ -173,14 +183,14 @@ int main(void) {
         }
                 
 
-        while(ezoGetData(EC_SENSOR_ADDRESS) > EC_THRESHOLD) {
+        while(ezoGetFixed(EC_SENSOR_ADDRESS, 0) > EZO_FIXED(EC_THRESHOLD)) {
             usbLog("Warning", "EC threshold exceeded");
             LED_Pin_Write(1);
             Pump0_En_Write(FALSE);
             Pump1_En_Write(FALSE);
             Pump2_En_Write(FALSE);
             UV_En_Write(FALSE);
-            CyDelay(1000);
+            pollWhileWaiting(1000); /* Readings only update while ezoRun() is called */
         }
         
         while(FALSE /*getPressure(PSENSOR_ZERO) > PSENSOR_ZERO_THRESHOLD */) {
@@ -210,18 +220,19 @@ int main(void) {
 
 
 void runHighPower(void) {
+    uint32 events = drainTankEvents();
     tankStruct tankStates = tankGetStates();
     uint8 filterStageActive, roStageActive, uvStageActive;
     
     /* Turn devices off if appropriate */
-    if (tankClearEvent(TANK_EVENT_0_EMPTY) || tankClearEvent(TANK_EVENT_1_FULL)) {
+    if (events & (TANK_EVENT_0_EMPTY | TANK_EVENT_1_FULL)) {
         filterStageActive = FALSE;
         
     }
-    if (tankClearEvent(TANK_EVENT_1_EMPTY) || tankClearEvent(TANK_EVENT_2_FULL)) {
+    if (events & (TANK_EVENT_1_EMPTY | TANK_EVENT_2_FULL)) {
         roStageActive = FALSE;    
     }
-    if (tankClearEvent(TANK_EVENT_2_EMPTY) || tankClearEvent(TANK_EVENT_3_FULL)) {
+    if (events & (TANK_EVENT_2_EMPTY | TANK_EVENT_3_FULL)) {
         uvStageActive = FALSE;    
     }
     
@@ -259,6 +270,7 @@ void midPowerInit(void) {
 
 void runMidPower(void) {
     
+    uint32 events = drainTankEvents();
     tankStruct tankStates = tankGetStates();
     switch(midPowerState) {
             
@@ -282,7 +294,7 @@ void runMidPower(void) {
         
         case STATE_RUN_P0:
             Pump0_En_Write(TRUE);
-            if (tankClearEvent(TANK_EVENT_0_EMPTY) || tankClearEvent(TANK_EVENT_1_FULL)) {
+            if (events & (TANK_EVENT_0_EMPTY | TANK_EVENT_1_FULL)) {
                 Pump0_En_Write(FALSE);
                 midPowerState = STATE_IDLE;
             }
@@ -290,7 +302,7 @@ void runMidPower(void) {
 
         case STATE_RUN_P1:
             Pump1_En_Write(TRUE);
-            if (tankClearEvent(TANK_EVENT_1_EMPTY) || tankClearEvent(TANK_EVENT_2_FULL)) {
+            if (events & (TANK_EVENT_1_EMPTY | TANK_EVENT_2_FULL)) {
                 Pump1_En_Write(FALSE);
                 midPowerState = STATE_IDLE;
             }
@@ -300,7 +312,7 @@ void runMidPower(void) {
 
             Pump2_En_Write(TRUE);
             UV_En_Write(TRUE);
-            if (tankClearEvent(TANK_EVENT_2_EMPTY) || tankClearEvent(TANK_EVENT_3_FULL)) {
+            if (events & (TANK_EVENT_2_EMPTY | TANK_EVENT_3_FULL)) {
                 Pump2_En_Write(FALSE);
                 UV_En_Write(FALSE);
                 midPowerState = STATE_IDLE;
@@ -337,7 +349,7 @@ void lowPowerInit(void) {
 
 CY_ISR(Watchdog_ISR) {
     /* Turn on bubbler if DO exceeds threshold */
-    Bubbler_En_Write(ezoGetData(DO_SENSOR_ADDRESS) > DO_THRESHOLD);
+    Bubbler_En_Write(ezoGetFixed(DO_SENSOR_ADDRESS, 0) > EZO_FIXED(DO_THRESHOLD));
     
     Timer_Watchdog_STATUS;
 }
@@ -371,6 +383,50 @@ uint8 getDutyCycle(uint8 potIndex) {
 }
 
 
+/*
+[desc]  Takes every record from the tank event queue, timing each tank's fill from
+        its empty event to its full event along the way. A full event with no empty
+        event before it, as when a tank starts out part full, times nothing.
+
+[ret]   The TankEventFlags of every event taken, and of any held by
+        pollWhileWaiting(), ORed together.
+*/
+uint32 drainTankEvents(void) {
+    TankEventRecord record;
+    uint32 events = heldTankEvents;
+    heldTankEvents = TANK_EVENT_NONE;
+    while (tankPollEvent(&record)) {
+        if (record.event == TANK_EVENT_EMPTY(record.tank)) {
+            tankEmptiedAt[record.tank] = record.timestamp;
+            tankEmptiedAtValid[record.tank] = TRUE;
+        } else if (tankEmptiedAtValid[record.tank]) {
+            tankFillTime[record.tank] = record.timestamp - tankEmptiedAt[record.tank];
+            tankEmptiedAtValid[record.tank] = FALSE;
+        }
+        events |= record.event;
+    }
+    return events;
+}
+
+
+/*
+[desc]  Waits, calling ezoRun() and tstarRun() every millisecond so I2C and Modbus
+        transfers keep moving, and draining the tank event queue so it can't
+        overflow. The events drained are held for the next drainTankEvents().
+
+[milliseconds] How long to wait.
+*/
+void pollWhileWaiting(uint32 milliseconds) {
+    uint32 i;
+    for (i = 0; i < milliseconds; i++) {
+        ezoRun();
+        tstarRun();
+        heldTankEvents |= drainTankEvents();
+        CyDelay(1);
+    }
+}
+
+
 
 
 
@@ -440,7 +496,7 @@ int main(void) {
                 LCD_Position(1, 0);
                 LCD_PrintHexUint16(tankEvents);
                 
-                if (tankEventoccurred(TANK_EVENT_0_EMPTY) || tankEventoccurred(TANK_EVENT_1_FULL)) {
+                if (tankEventOccurred(TANK_EVENT_0_EMPTY) || tankEventOccurred(TANK_EVENT_1_FULL)) {
                     Pump0_Out_Pin_Write(FALSE);
                     machineState = STATE_IDLE;
                     tankEvents = TANK_EVENT_NONE;
@@ -454,7 +510,7 @@ int main(void) {
                 LCD_Position(1, 0);
                 LCD_PrintHexUint16(tankEvents);
                 
-                if (tankEventoccurred(TANK_EVENT_1_EMPTY) || tankEventoccurred(TANK_EVENT_0_FULL)) {
+                if (tankEventOccurred(TANK_EVENT_1_EMPTY) || tankEventOccurred(TANK_EVENT_0_FULL)) {
                     Pump1_Out_Pin_Write(FALSE);
                     machineState = STATE_IDLE;
                     tankEvents = TANK_EVENT_NONE;
@@ -468,7 +524,7 @@ int main(void) {
                 LCD_Position(1, 0);
                 LCD_PrintHexUint16(tankEvents);
                 
-                if (tankEventoccurred(TANK_EVENT_2_EMPTY) || tankEventoccurred(TANK_EVENT_3_FULL)) {
+                if (tankEventOccurred(TANK_EVENT_2_EMPTY) || tankEventOccurred(TANK_EVENT_3_FULL)) {
                     Pump2_Out_Pin_Write(FALSE);
                     machineState = STATE_IDLE;
                     tankEvents = TANK_EVENT_NONE;
@@ -478,7 +534,7 @@ int main(void) {
             case STATE_RECIRCULATE_UV:
                 LCD_ClearDisplay();
                 LCD_PrintString("RECIRCULATE UV");
-                if ( (tankEventoccurred(TANK_EVENT_1_EMPTY) || tankEventoccurred(TANK_EVENT_2_EMPTY) || tankEventoccurred(TANK_EVENT_3_EMPTY))
+                if ( (tankEventOccurred(TANK_EVENT_1_EMPTY) || tankEventOccurred(TANK_EVENT_2_EMPTY) || tankEventOccurred(TANK_EVENT_3_EMPTY))
                         && ecThresholdFlag == FALSE) {
                     Pump3_Out_Pin_Write(FALSE);
                     machineState = STATE_IDLE;
@@ -0,0 +1,25 @@
+/*
+    Carl Lindquist
+    Oct 17, 2026
+
+    Tanks of the Waterlab One, for the tank library. See tank.h.
+        0: Source
+        1: Filtered
+        2: Permeate
+        3: Disinfected
+*/
+
+#ifndef TANK_CONFIG_H
+#define TANK_CONFIG_H
+
+
+#define MAX_TANK_COUNT 4
+
+#define TANK_DESCRIPTORS(TANK) \
+    TANK(0, Switch0_In_Pin, Switch1_In_Pin, FSWITCH_ACTIVE_LOW) \
+    TANK(1, Switch2_In_Pin, Switch3_In_Pin, FSWITCH_ACTIVE_LOW) \
+    TANK(2, Switch4_In_Pin, Switch5_In_Pin, FSWITCH_ACTIVE_LOW) \
+    TANK(3, Switch6_In_Pin, Switch7_In_Pin, FSWITCH_ACTIVE_LOW)
+
+
+#endif /* TANK_CONFIG_H */
@@ -10,7 +10,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 
-#include "floatSwitch.h"
+#include "tank.h"
 
 #define TRUE 1
 #define FALSE 0
@@ -31,7 +31,7 @@ int main(void)
     LCD_Start();
     LCD_PrintString("Hello World");
     
-    floatSwitchInit();
+    tankInit();
     
     machineState = STATE_RUN_P1;
     
@@ -46,16 +46,16 @@ int main(void)
                 LCD_ClearDisplay();
                 LCD_PrintString("RUN PUMP 1");
                 LCD_Position(1, 0);
-                LCD_PrintHexUint16(fswitchEvents);
+                LCD_PrintHexUint16(tankEvents);
 
                 
                 LED4_Pin_Write(TRUE);
                 LED3_Pin_Write(FALSE);
                 
-                if (fsEventOccured(FSWITCH_EVENT_1_ON) || fsEventOccured(FSWITCH_EVENT_2_ON)) {
+                if (tankEventOccurred(TANK_EVENT_FULL(1)) || tankEventOccurred(TANK_EVENT_FULL(2))) {
                     
                     machineState = STATE_RUN_P2;
-                    fswitchEvents = FSWITCH_EVENT_NONE;
+                    tankEvents = TANK_EVENT_NONE;
                 }
                 break;
 
@@ -66,16 +66,16 @@ int main(void)
                 LCD_ClearDisplay();
                 LCD_PrintString("RUN PUMP 2");
                 LCD_Position(1, 0);
-                LCD_PrintHexUint16(fswitchEvents);
+                LCD_PrintHexUint16(tankEvents);
 
                 
                 LED4_Pin_Write(FALSE);
                 LED3_Pin_Write(TRUE);
                 
-                if (fsEventOccured(FSWITCH_EVENT_3_ON) || fsEventOccured(FSWITCH_EVENT_0_ON)) {
+                if (tankEventOccurred(TANK_EVENT_FULL(3)) || tankEventOccurred(TANK_EVENT_FULL(0))) {
                     
                     machineState = STATE_RUN_P1;
-                    fswitchEvents = FSWITCH_EVENT_NONE;
+                    tankEvents = TANK_EVENT_NONE;
                 }
                 break;
         }
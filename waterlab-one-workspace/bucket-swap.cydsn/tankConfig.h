@@ -0,0 +1,23 @@
+/*
+    Carl Lindquist
+    Oct 17, 2026
+
+    Float switches of the bucket swap, for the tank library. See tank.h. Each
+    switch is the full switch of a tank of its own, so TANK_EVENT_FULL(n) is
+    switch n turning on.
+*/
+
+#ifndef TANK_CONFIG_H
+#define TANK_CONFIG_H
+
+
+#define MAX_TANK_COUNT 4
+
+#define TANK_DESCRIPTORS(TANK) \
+    TANK(0, Switch0_In_Pin, FSWITCH_NO_PIN, FSWITCH_ACTIVE_LOW) \
+    TANK(1, Switch1_In_Pin, FSWITCH_NO_PIN, FSWITCH_ACTIVE_LOW) \
+    TANK(2, Switch2_In_Pin, FSWITCH_NO_PIN, FSWITCH_ACTIVE_LOW) \
+    TANK(3, Switch3_In_Pin, FSWITCH_NO_PIN, FSWITCH_ACTIVE_LOW)
+
+
+#endif /* TANK_CONFIG_H */
@@ -2,42 +2,124 @@
     Carl Lindquist
     Mar 17, 2017
     Library for interfacing with the Atlas-Scientific EZO class circuits
-    over I2C. This library will poll the sensors using a hardware timer 
-    and store data points for immediate public access to recent readings.
+    over I2C. This library will poll the sensors on the I2C bus's millisecond
+    clock and store data points for immediate public access to recent readings.
 
-    The I2C prefixed functions in this library are generic, and can be
-    adapted for any I2C master functionality.
+    All I2C traffic goes through the transaction scheduler in i2cBus.c,
+    advanced by ezoRun() from the main loop, and replies are parsed in the main
+    loop. Each circuit in EZO_SENSORS is a client of the bus at the priority it
+    is listed with, and setup shell commands come last. The bus takes turns
+    between the circuits and writes to one while others settle, so every
+    circuit is read each poll period however many there are.
+
+    Each circuit keeps its own poll period. It is EZO_MIN_INTERVAL while the
+    process is active or the circuit's readings move more than its type's noise
+    band, measured as a running variance. Otherwise it doubles with every
+    reading, up to EZO_MAX_INTERVAL. Circuits polled EZO_SLEEP_INTERVAL or more
+    apart are sent "Sleep" after each reading, and the next "R" wakes them. A
+    reading that fails, as the first after waking may, is retried after
+    EZO_MIN_INTERVAL.
+
+    Replies are parsed where the bus left them, straight into integers counting
+    1/EZO_SCALE of the sensor's unit, so nothing here needs soft-float.
 */
 
 #include "ezoProtocol.h"
+#include "i2cBus.h"
+#include "msClock.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 //#define PRINT_DATA
 
+/* Milliseconds between readings, see above */
+#define EZO_MIN_INTERVAL 2000
+#define EZO_MAX_INTERVAL 300000
+#define EZO_SLEEP_INTERVAL 10000
+#define EZO_VARIANCE_WEIGHT 4 /* Readings the running mean and variance roughly average over */
+
+#define EZO_SCALE_DIGITS 3 /* Decimal places kept, EZO_SCALE is 10 to this power */
+#define EZO_FIXED_LIMIT 214748363 /* Largest magnitude that can take another digit and still fit an int32 */
+
+/* Milliseconds each client's transactions may wait before going ahead of every class */
+#define SAFETY_MAX_WAIT 250
+#define POLL_MAX_WAIT 2000
+#define SHELL_MAX_WAIT 2000
+
+/* Generator expanded over EZO_SENSORS */
+#define EZO_SENSOR_ENTRY(address, type, command, settleTime, priority) \
+    {address, type, command, settleTime, priority},
+
+#if EZO_SENSOR_COUNT + 1 > I2C_MAX_CLIENTS
+    #error "Every sensor and the shell need their own I2C client"
+#endif
+#if EZO_SENSOR_COUNT > I2C_MAX_SETTLING
+    #error "Every sensor needs a settling slot to be read each poll period"
+#endif
+
 
 //––––––  Private Variables  ––––––//
 uint8 autoPollEn;
-uint8 dataRequested;
-double recentECData;
-double recentDOData;
+uint8 processActive;
+
+static const EzoSensor ezoSensors[EZO_SENSOR_COUNT] = { EZO_SENSORS(EZO_SENSOR_ENTRY) };
+static const char* const ezoTypeNames[EZO_TYPE_COUNT] = {"EC", "DO", "pH", "ORP", "RTD"};
+
+/* Standard deviation of a steady reading, in uS/cm, mg/L, pH, mV and degrees C */
+static const int32 ezoNoiseBands[EZO_TYPE_COUNT] = {EZO_FIXED(10.0), EZO_FIXED(0.1), EZO_FIXED(0.02),
+        EZO_FIXED(2.0), EZO_FIXED(0.1)};
+static char sleepCommand[] = "Sleep";
+
+/* Indexed like ezoSensors. Replies are read straight into each sensor's buffer. */
+int32 recentData[EZO_SENSOR_COUNT][EZO_MAX_FIELDS];
+I2cClient sensorClients[EZO_SENSOR_COUNT];
+I2cTransaction sensorReadings[EZO_SENSOR_COUNT];
+arrStruct sensorResponses[EZO_SENSOR_COUNT];
+I2cTransaction sensorSleeps[EZO_SENSOR_COUNT];
+uint32 sampledAt[EZO_SENSOR_COUNT]; /* When the last reading was asked for */
+uint32 sampleInterval[EZO_SENSOR_COUNT];
+int32 runningMean[EZO_SENSOR_COUNT]; /* Of the first field */
+int64 runningVariance[EZO_SENSOR_COUNT];
+uint8 sampled[EZO_SENSOR_COUNT]; /* Whether runningMean holds a reading yet */
+
+I2cClient shellClient;
 
 
 //––––––  Private Declarations  ––––––//
 
-void i2cSendString(uint8 slaveAddress, char string[]);
-arrStruct i2cReadString(uint8 slaveAddress);
-CY_ISR_PROTO(I2C_DATA_ISR);
+uint8 ezoRecord(I2cTransaction* reading, int32 data[]);
+uint8 ezoParseFixed(const char** cursor, int32* value);
+void ezoAdapt(uint8 index);
+void ezoStatusLetter(char response[]);
 
 
 //––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
 
 void ezoStart(void) {
-    I2CM_Start();
+    const EzoSensor* sensor;
+    uint8 i, field;
+    
+    i2cStart();
+    for (i = 0; i < EZO_SENSOR_COUNT; i++) {
+        sensor = &ezoSensors[i];
+        i2cAddClient(&sensorClients[i], sensor->priority,
+                sensor->priority == I2C_PRIORITY_SAFETY ? SAFETY_MAX_WAIT : POLL_MAX_WAIT);
+        sensorReadings[i] = (I2cTransaction) {sensor->address, (uint8*) sensor->command,
+                strlen(sensor->command), (uint8*) sensorResponses[i].d, MAX_RESPONSE_LENGTH,
+                sensor->settleTime, I2C_STATUS_IDLE, 0};
+        sensorSleeps[i] = (I2cTransaction) {sensor->address, (uint8*) sleepCommand,
+                strlen(sleepCommand), NULL, 0, 0, I2C_STATUS_IDLE, 0};
+        for (field = 0; field < EZO_MAX_FIELDS; field++) {
+            recentData[i][field] = EZO_NO_READING;
+        }
+        sampleInterval[i] = EZO_MIN_INTERVAL;
+        sampledAt[i] = msClockNow() - EZO_MIN_INTERVAL; /* Due at once */
+        sampled[i] = 0;
+    }
+    i2cAddClient(&shellClient, I2C_PRIORITY_SHELL, SHELL_MAX_WAIT);
     autoPollEn = 1;
-    dataRequested = 0;
-    One_Sec_Timer_Start();
-    I2C_Data_Interrupt_StartEx(I2C_DATA_ISR);
+    processActive = 1;
 }
 
 
@@ -50,127 +132,247 @@ void ezoSetAutoPoll(uint8 value) {
 }
 
 
-arrStruct ezoSendAndPoll(uint8 slaveAddress, char string[], uint16 delay) {
-    uint8 tmp = autoPollEn;
-     
-    while(dataRequested && autoPollEn); /* Wait for any auto polling to complete */
-    autoPollEn = 0;
+void ezoSetProcessActive(uint8 active) {
+    uint8 i;
+    if (active && !processActive) {
+        for (i = 0; i < EZO_SENSOR_COUNT; i++) {
+            sampleInterval[i] = EZO_MIN_INTERVAL;
+        }
+    }
+    processActive = active ? 1 : 0;
+}
+
+
+void ezoRun(void) {
+    uint32 now = msClockNow();
+    uint8 i;
+    #ifdef PRINT_DATA
+        char outstring[30] = {};
+    #endif
     
-    i2cSendString(slaveAddress, string);
-    CyDelay(delay);
-    arrStruct response = i2cReadString(slaveAddress);
+    if (autoPollEn) {
+        for (i = 0; i < EZO_SENSOR_COUNT; i++) {
+            if (now - sampledAt[i] >= sampleInterval[i]
+                    && i2cSubmit(&sensorClients[i], &sensorReadings[i])) { /* Refused while the last reading is in progress */
+                sampledAt[i] = now;
+            }
+        }
+    }
+    i2cRun();
+    
+    for (i = 0; i < EZO_SENSOR_COUNT; i++) {
+        if (!i2cFinished(&sensorReadings[i])) {
+            continue;
+        }
+        if (!ezoRecord(&sensorReadings[i], recentData[i])) {
+            sampledAt[i] = msClockNow() - sampleInterval[i] + EZO_MIN_INTERVAL; /* Try again soon */
+        } else {
+            ezoAdapt(i);
+            #ifdef PRINT_DATA
+                sprintf(outstring, "%s: %s%ld.%03ld      ", ezoTypeNames[ezoSensors[i].type],
+                        recentData[i][0] < 0 ? "-" : "", labs(recentData[i][0]) / EZO_SCALE,
+                        labs(recentData[i][0]) % EZO_SCALE);
+                LCD_Position(i % 2, 0); /* Two line display */
+                LCD_PrintString(outstring);
+            #endif
+        }
+    }
+}
+
+
+arrStruct ezoSendAndPoll(uint8 slaveAddress, char string[], uint16 delay) {
+    arrStruct response = {};
+    I2cTransaction command = {slaveAddress, (uint8*) string, strlen(string), (uint8*) response.d,
+            MAX_RESPONSE_LENGTH, delay, I2C_STATUS_IDLE, 0};
     
-    autoPollEn = tmp;
+    while (!i2cSubmit(&shellClient, &command)) {
+        ezoRun();
+    }
+    while (!i2cFinished(&command)) { /* Auto polling carries on around the command */
+        ezoRun();
+    }
+    ezoStatusLetter(response.d);
     return response;
 }
 
 
 double ezoGetData(uint8 slaveAddress) {
-    if (slaveAddress == EC_SENSOR_ADDRESS) {
-        return recentECData;
-    } else if (slaveAddress == DO_SENSOR_ADDRESS) {
-        return recentDOData;    
-    } else {
-        return -1.0;
+    int32 value = ezoGetFixed(slaveAddress, 0);
+    return value == EZO_NO_READING ? -1.0 : (double) value / EZO_SCALE;
+}
+
+
+int32 ezoGetFixed(uint8 slaveAddress, uint8 field) {
+    uint8 i;
+    if (field >= EZO_MAX_FIELDS) {
+        return EZO_NO_READING;
     }
+    for (i = 0; i < EZO_SENSOR_COUNT; i++) {
+        if (ezoSensors[i].address == slaveAddress) {
+            return recentData[i][field];
+        }
+    }
+    return EZO_NO_READING;
+}
+
+
+const EzoSensor* ezoSensor(uint8 index) {
+    return index < EZO_SENSOR_COUNT ? &ezoSensors[index] : NULL;
+}
+
+
+const char* ezoTypeName(uint8 type) {
+    return type < EZO_TYPE_COUNT ? ezoTypeNames[type] : "EZO";
 }
 
 
 //––––––––––––––––––––––––––––––  Private Functions  ––––––––––––––––––––––––––––––//
 
 /*
-[desc]  Sends a string to the slave specified by slaveAddress in I2C protocol. Assumes
-		this device is set up as an I2C Master with a hardware block named I2CM.
+[desc]  Parses a finished auto-polling reading and frees the transaction to be
+        submitted again. The reply is read where it lies, a comma separated list of
+        fields such as "1413,707,0.70,1.000" from an EC circuit.
+
+[reading] The transaction to check.
+[data] EZO_MAX_FIELDS values, set to the reading's fields if the sensor sent one.
+       Fields the sensor didn't send are set to EZO_NO_READING.
 
-[slaveAddress] Address of an I2C device between 0 and 127
-[string] A string to send over I2C
+[ret]   1 if data was set, 0 if the reading hasn't finished or held no reading.
 */
-void i2cSendString(uint8 slaveAddress, char string[]) {
-    /* Initiate transfer */
-    uint8 temp = 0;
-    do {
-        I2CM_MasterWriteBuf(slaveAddress, (uint8*)string, strlen(string), I2CM_MODE_COMPLETE_XFER);
-    } while(temp != I2CM_MSTR_NO_ERROR);
+uint8 ezoRecord(I2cTransaction* reading, int32 data[]) {
+    char* response = (char*) reading->response;
+    const char* cursor = &response[1];
+    int32 fields[EZO_MAX_FIELDS];
+    uint8 status = reading->status;
+    uint8 count = 0, field;
     
-    while(I2CM_MasterStatus() & I2CM_MSTAT_XFER_INP); /* Wait for transfer to finish */
+    if (!i2cFinished(reading)) {
+        return 0;
+    }
+    reading->status = I2C_STATUS_IDLE;
+    if (status == I2C_STATUS_FAILED) {
+        return 0;
+    }
+    
+    ezoStatusLetter(response);
+    if (response[0] != 'S') {
+        return 0;
+    }
+    while (count < EZO_MAX_FIELDS && ezoParseFixed(&cursor, &fields[count])) {
+        count++;
+        if (*cursor != ',') {
+            break;
+        }
+        cursor++;
+    }
+    if (count == 0) { /* Not a reading, such as the reply to another command */
+        return 0;
+    }
+    for (field = 0; field < EZO_MAX_FIELDS; field++) {
+        data[field] = field < count ? fields[field] : EZO_NO_READING;
+    }
+    return 1;
 }
 
 
 /*
-[desc]  Reads a buffer from the slave specified by slaveAddress in I2C protocol. Assumes
-		this device is set up as an I2C Master with a hardware block named I2CM.
+[desc]  Parses a decimal number such as "-12.5" into 1/EZO_SCALE units, rounding
+        digits past EZO_SCALE_DIGITS decimal places.
 
-[slaveAddress] Address of an I2C device between 0 and 127
+[cursor] Points at the number, moved to the first character after it.
+[value] Set to the number on success.
 
-[ret]	An arrStruct holding the buffer of data read from the slave.
+[ret]   1 on success, 0 if there is no number at the cursor or it doesn't fit.
 */
-arrStruct i2cReadString(uint8 slaveAddress) {
-    /* Initiate transfer */
-    uint8 temp = 0;
-//    char tempArray[MAX_RESPONSE_LENGTH] = {};
-    arrStruct response = {};
+uint8 ezoParseFixed(const char** cursor, int32* value) {
+    const char* c = *cursor;
+    uint32 magnitude = 0;
+    uint8 negative = 0, digits = 0, decimals = 0, fraction = 0;
+    
+    if (*c == '-') {
+        negative = 1;
+        c++;
+    }
+    for (; (*c >= '0' && *c <= '9') || (*c == '.' && !fraction); c++) {
+        if (*c == '.') {
+            fraction = 1;
+        } else if (decimals < EZO_SCALE_DIGITS || !fraction) {
+            if (magnitude > EZO_FIXED_LIMIT) {
+                return 0;
+            }
+            magnitude = magnitude * 10 + (*c - '0');
+            decimals += fraction;
+            digits++;
+        } else if (decimals++ == EZO_SCALE_DIGITS && *c >= '5') {
+            magnitude++; /* Rounds on the first digit dropped */
+        }
+    }
+    if (digits == 0) {
+        return 0;
+    }
+    for (; decimals < EZO_SCALE_DIGITS; decimals++) {
+        if (magnitude > EZO_FIXED_LIMIT) {
+            return 0;
+        }
+        magnitude *= 10;
+    }
     
-    do {
-		temp = I2CM_MasterReadBuf(slaveAddress, (uint8*)response.d, MAX_RESPONSE_LENGTH, I2CM_MODE_COMPLETE_XFER);
-    } while (temp != I2CM_MSTR_NO_ERROR);
+    *cursor = c;
+    *value = negative ? -(int32) magnitude : (int32) magnitude;
+    return 1;
+}
+
+
+/*
+[desc]  Folds a sensor's newest reading into its running mean and variance, picks
+        its next poll period, and puts it to sleep until then if the period is long.
+
+[index] Position of the sensor in ezoSensors.
+*/
+void ezoAdapt(uint8 index) {
+    int64 band = ezoNoiseBands[ezoSensors[index].type];
+    int64 difference = (int64) recentData[index][0] - runningMean[index];
     
-    while(I2CM_MasterStatus() & I2CM_MSTAT_XFER_INP); /* Wait for transfer to finish */
+    if (!sampled[index]) {
+        sampled[index] = 1;
+        runningMean[index] = recentData[index][0];
+        runningVariance[index] = 0;
+    } else {
+        runningMean[index] += difference / EZO_VARIANCE_WEIGHT;
+        runningVariance[index] += (difference * difference - runningVariance[index]) / EZO_VARIANCE_WEIGHT;
+    }
     
-    /* Convert EZO status byte to a letter inside standard ASCII table */
-    if (response.d[0] == 1) {           /* EZO SUCCESS */ 
-        response.d[0] = 'S';    
-    } else if (response.d[0] == 2) {    /* EZO ERROR, invalid command or other problem */
-        response.d[0] = 'E';
-    } else if (response.d[0] == 255) {  /* EZO NO data to send */
-        response.d[0] = 'N';
-    } else if (response.d[0] == 254) {  /* EZO PROCESSING, not ready */
-        response.d[0] = 'P';
+    if (processActive || runningVariance[index] > band * band) {
+        sampleInterval[index] = EZO_MIN_INTERVAL;
+    } else if (sampleInterval[index] < EZO_MAX_INTERVAL / 2) {
+        sampleInterval[index] *= 2;
+    } else {
+        sampleInterval[index] = EZO_MAX_INTERVAL;
     }
     
-    return response;
+    if (sampleInterval[index] >= EZO_SLEEP_INTERVAL) {
+        i2cSubmit(&sensorClients[index], &sensorSleeps[index]);
+    }
 }
 
 
 /*
-[desc]  ISR which records data from both EZO sensors every other time it is called.
+[desc]  Converts the EZO status byte at the start of a response to a letter inside the
+        standard ASCII table.
+
+[response] A response read from an EZO circuit.
 */
-CY_ISR(I2C_DATA_ISR) {
-    if (autoPollEn) {
-        if (!dataRequested) {
-            /* Ask each sensor to take a reading */
-            i2cSendString(EC_SENSOR_ADDRESS, "R");
-            i2cSendString(DO_SENSOR_ADDRESS, "R"); 
-        } else {
-            #ifdef PRINT_DATA
-                LCD_ClearDisplay();
-                char outstring[30] = {};
-            #endif
-            /* Ask the sensors for the last readings they took */
-            arrStruct ecResponse = i2cReadString(EC_SENSOR_ADDRESS);
-            arrStruct doResponse = i2cReadString(DO_SENSOR_ADDRESS);
-            
-            /* Successful EC Read */
-            if (ecResponse.d[0] == 'S' && 48 <= ecResponse.d[1] && ecResponse.d[1] <= 57) {
-                sscanf(&ecResponse.d[1], "%lf", &recentECData);
-                #ifdef PRINT_DATA
-                    sprintf(outstring, "EC: %lf", recentECData);
-                    LCD_PrintString(outstring);
-                #endif
-            }
-            /* Successful DO Read */
-            if (doResponse.d[0] == 'S' && 48 <= doResponse.d[1] && doResponse.d[1] <= 57) {
-                sscanf(&doResponse.d[1], "%lf", &recentDOData);
-                #ifdef PRINT_DATA
-                    sprintf(outstring, "DO: %lf", recentDOData);
-                    LCD_Position(1,0);
-                    LCD_PrintString(outstring);
-                #endif
-            }
-        }
-        dataRequested = ~dataRequested;
+void ezoStatusLetter(char response[]) {
+    if (response[0] == 1) {             /* EZO SUCCESS */ 
+        response[0] = 'S';    
+    } else if (response[0] == 2) {      /* EZO ERROR, invalid command or other problem */
+        response[0] = 'E';
+    } else if ((uint8) response[0] == 255) {    /* EZO NO data to send */
+        response[0] = 'N';
+    } else if ((uint8) response[0] == 254) {    /* EZO PROCESSING, not ready */
+        response[0] = 'P';
     }
-    
-    One_Sec_Timer_STATUS; /* Clear ISR */
 }
 
+
 /* EOF */
\ No newline at end of file
@@ -3,23 +3,70 @@
     Mar 17, 2017
 
     Library for interfacing with the Atlas-Scientific EZO class circuits
-    over I2C. This library will poll the sensors using a hardware timer 
-    and store data points for immediate public access to recent readings.
+    over I2C. This library will poll the sensors on the I2C bus's millisecond
+    clock and store data points for immediate public access to recent readings.
+    Call ezoRun() from the main loop to keep the readings coming, and
+    ezoSetProcessActive() whenever pumps start or stop.
+
+    Sensors are polled every 2 seconds while the process is active or their
+    readings are changing. While the plant is idle and a sensor's readings are
+    steady it is polled less and less often, down to once every 5 minutes, and
+    put in its sleep mode between readings.
+
+    Circuits are described at compile time in the project's own ezoConfig.h,
+    which lists every circuit in EZO_SENSORS:
+
+        #define EZO_SENSORS(EZO_SENSOR) \
+            EZO_SENSOR(100, EZO_TYPE_EC, "R", 1000, I2C_PRIORITY_SAFETY) \
+            EZO_SENSOR(99, EZO_TYPE_PH, "R", 1000, I2C_PRIORITY_BACKGROUND)
+
+    Each entry is the circuit's I2C address, its EzoType, the command that takes
+    a reading, the milliseconds the circuit needs before the reading can be
+    collected, and the I2cPriority of its readings. Every circuit is its own
+    client of the I2C bus, so readings go out round-robin and one circuit is
+    asked for its next reading while others are still converting. Adding a
+    circuit costs the others a few milliseconds of bus time, not a reading.
 */
     
 #ifndef EZO_PROTOCOL_H
 #define EZO_PROTOCOL_H
 
 #include "project.h"
+#include "ezoConfig.h"
     
     
 #define MAX_RESPONSE_LENGTH 128
-#define EC_SENSOR_ADDRESS 100
-#define DO_SENSOR_ADDRESS 97
+#define EZO_MAX_FIELDS 4 /* An EC circuit sends EC, TDS, SAL and SG */
+
+/* Readings are kept as integer counts of 1/EZO_SCALE of the sensor's unit */
+#define EZO_SCALE 1000
+#define EZO_FIXED(value) ((int32) ((value) * EZO_SCALE + ((value) < 0 ? -0.5 : 0.5))) /* For constants */
+#define EZO_NO_READING ((int32) 0x80000000) /* No sensor, field or reading yet */
+
+/* Number of circuits in EZO_SENSORS */
+#define EZO_COUNT_SENSOR(address, type, command, settleTime, priority) + 1
+#define EZO_SENSOR_COUNT (0 EZO_SENSORS(EZO_COUNT_SENSOR))
     
 
 typedef struct arrStruct { char d[MAX_RESPONSE_LENGTH]; } arrStruct;
 
+typedef enum {
+    EZO_TYPE_EC, /* Electrical conductivity */
+    EZO_TYPE_DO, /* Dissolved oxygen */
+    EZO_TYPE_PH,
+    EZO_TYPE_ORP, /* Oxidation-reduction potential */
+    EZO_TYPE_RTD, /* Temperature */
+    EZO_TYPE_COUNT,
+} EzoTypes;
+
+typedef struct EzoSensor {
+    uint8 address;
+    uint8 type; /* An EzoType */
+    const char* command; /* Takes a reading */
+    uint16 settleTime; /* Milliseconds between sending command and collecting the reading */
+    uint8 priority; /* An I2cPriority */
+} EzoSensor;
+
 
 //––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
 
@@ -31,7 +78,7 @@ void ezoStart(void);
 
 
 /*
-[desc]  Turns auto polling for data from the two EZO sensors ON or OFF
+[desc]  Turns auto polling for data from the EZO sensors ON or OFF
         according to the value passed in. Passing in a 0 disables 
         autopolling, anything else will enable it.
 
@@ -40,15 +87,35 @@ void ezoStart(void);
 void ezoSetAutoPoll(uint8 value);
 
 
+/*
+[desc]  Tells the library whether the process is running, which decides how often the
+        sensors are polled. Polling drops back to every 2 seconds as soon as the
+        process becomes active. The library starts out active.
+
+[active] Nonzero while any pump is running, 0 while the plant is idle.
+*/
+void ezoSetProcessActive(uint8 active);
+
+
+/*
+[desc]  Moves auto polling along: submits readings as they come due,
+        advances the I2C bus and records finished readings. Never blocks. Call
+        it often from the main loop, never from an ISR.
+*/
+void ezoRun(void);
+
+
 /*
 [desc]  Use this function to send single requests to a slave device. This
-        method will wait until any autopolling is finished, then send 'string'
-        to the 'slaveAddress'. It will then wait for 'delay' amount of time
-        to read data from the slave.
+        method waits for its turn on the bus, behind anything already talking to
+        'slaveAddress', then sends 'string' to it. It will then wait for 'delay'
+        amount of time to read data from the slave. Auto polling of other
+        sensors carries on meanwhile. A sensor asleep between readings wakes on the
+        command but may not answer it, so it may need sending again.
 
 [slaveAddress] Slave address to send and request from.
 [string] A string to send to the slave.
-[delay] Time is uS to wait between sending and requesting.
+[delay] Time in mS to wait between sending and requesting.
 
 [ret]   An arrStruct containing the slave's response.
 */
@@ -57,16 +124,50 @@ arrStruct ezoSendAndPoll(uint8 slaveAddress, char string[], uint16 delay);
 /*
 [desc]  Returns the most recently recorded data from a sensor addressed by
         its I2C slave address. Note that this function does not directly
-        communicate with a sensor, as data is collected automatically every
-        2 seconds from each sensor. This method is non-blocking.
+        communicate with a sensor, as data is collected automatically from each
+        sensor by ezoRun(). This method is non-blocking.
 
 [slaveAddress] The I2C slave address of to ask for data.
 
-[ret] The most recently recorded data from the slave sensor.
+[ret] The most recently recorded data from the slave sensor, -1.0 if no sensor in
+      EZO_SENSORS has that address or it hasn't sent a reading yet.
 */
 double ezoGetData(uint8 slaveAddress);
 
 
+/*
+[desc]  Returns a field of the most recently recorded reading of a sensor in fixed
+        point, without any floating point math. Fields are in the order the circuit
+        sends them, which its output settings decide. Field 0 is the main reading,
+        such as EC from an EC circuit. Compare against EZO_FIXED() constants:
+
+            if (ezoGetFixed(EC_SENSOR_ADDRESS, 0) > EZO_FIXED(150.0)) ...
+
+[slaveAddress] The I2C slave address of to ask for data.
+[field] The field, from 0 to EZO_MAX_FIELDS - 1.
+
+[ret]   The field in 1/EZO_SCALE units, EZO_NO_READING if there is no sensor at the
+        address, it hasn't sent a reading yet or its last reading had no such field.
+*/
+int32 ezoGetFixed(uint8 slaveAddress, uint8 field);
+
+
+/*
+[desc]  Looks up a circuit listed in EZO_SENSORS.
+
+[index] Position of the circuit in EZO_SENSORS, from 0 to EZO_SENSOR_COUNT - 1.
+
+[ret]   The circuit's description, NULL if index is out of range.
+*/
+const EzoSensor* ezoSensor(uint8 index);
+
+
+/*
+[desc]  Returns a short name for an EzoType, such as "EC", for messages.
+*/
+const char* ezoTypeName(uint8 type);
+
+
 
 
 
@@ -0,0 +1,300 @@
+/*
+    Carl Lindquist
+    Oct 17, 2026
+
+    Non-blocking, prioritized I2C transactions for the PSoC 5LP. See i2cBus.h.
+    Assumes an I2C Master hardware block named I2CM, whose own interrupt moves
+    the bytes, and uses msClock for its timing.
+*/
+
+#include "i2cBus.h"
+#include "msClock.h"
+#include <stddef.h>
+
+#define I2C_CLIENT_QUEUE_MASK (I2C_CLIENT_QUEUE_SIZE - 1)
+
+#if (I2C_CLIENT_QUEUE_SIZE & I2C_CLIENT_QUEUE_MASK) != 0
+    #error "I2C_CLIENT_QUEUE_SIZE must be a power of two"
+#endif
+
+
+//––––––  Private Declarations  ––––––//
+
+I2cClient* i2cClients[I2C_MAX_CLIENTS];
+uint8 i2cClientCount;
+uint8 i2cNextClient; /* Where the next search for a client starts, so clients of a class take turns */
+I2cTransaction* i2cSettling[I2C_MAX_SETTLING]; /* Written to and waiting to be read, NULL slots are free */
+I2cTransaction* i2cActive; /* The transaction on the bus, NULL if none */
+uint32 i2cActiveSince; /* When the transfer on the bus started */
+
+uint8 i2cFinishActive(uint32 now);
+I2cClient* i2cSchedule(uint32 now);
+uint8 i2cSlaveBusy(uint8 slaveAddress);
+I2cTransaction** i2cFreeSettlingSlot(void);
+uint8 i2cTryBegin(I2cTransaction* transaction, uint8 status, uint32 now);
+uint8 i2cBegin(I2cTransaction* transaction, uint8 status, uint32 now);
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+void i2cStart(void) {
+    uint8 i;
+
+    I2CM_Start();
+    i2cClientCount = 0;
+    i2cNextClient = 0;
+    i2cActive = NULL;
+    for (i = 0; i < I2C_MAX_SETTLING; i++) {
+        i2cSettling[i] = NULL;
+    }
+    msClockStart();
+}
+
+
+uint8 i2cAddClient(I2cClient* client, uint8 priority, uint16 maxWait) {
+    if (i2cClientCount >= I2C_MAX_CLIENTS) {
+        return 0;
+    }
+    client->priority = priority;
+    client->maxWait = maxWait;
+    client->head = 0;
+    client->tail = 0;
+    i2cClients[i2cClientCount++] = client;
+    return 1;
+}
+
+
+uint8 i2cSubmit(I2cClient* client, I2cTransaction* transaction) {
+    uint8 status = transaction->status;
+    if ((uint8)(client->head - client->tail) >= I2C_CLIENT_QUEUE_SIZE
+            || (status != I2C_STATUS_IDLE && status != I2C_STATUS_DONE && status != I2C_STATUS_FAILED)) {
+        return 0;
+    }
+    transaction->status = I2C_STATUS_QUEUED;
+    transaction->time = msClockNow();
+    transaction->attempts = 0;
+    client->queue[client->head++ & I2C_CLIENT_QUEUE_MASK] = transaction;
+    return 1;
+}
+
+
+void i2cRun(void) {
+    uint32 now = msClockNow();
+    I2cTransaction* transaction;
+    I2cClient* client;
+    uint8 i;
+
+    if (i2cActive && !i2cFinishActive(now)) {
+        return; /* Still on the bus */
+    }
+
+    /* Slaves that have settled are read first, since they hold their slave */
+    for (i = 0; i < I2C_MAX_SETTLING; i++) {
+        transaction = i2cSettling[i];
+        if (transaction && (int32)(now - transaction->time) >= 0) {
+            if (i2cTryBegin(transaction, I2C_STATUS_READING, now)) {
+                i2cSettling[i] = NULL;
+            }
+            if (i2cActive) {
+                return;
+            }
+        }
+    }
+
+    client = i2cSchedule(now);
+    if (client) {
+        transaction = client->queue[client->tail & I2C_CLIENT_QUEUE_MASK];
+        if (i2cTryBegin(transaction, transaction->command ? I2C_STATUS_WRITING : I2C_STATUS_READING, now)) {
+            client->tail++;
+        }
+    }
+}
+
+
+uint8 i2cFinished(I2cTransaction* transaction) {
+    return transaction->status == I2C_STATUS_DONE || transaction->status == I2C_STATUS_FAILED;
+}
+
+
+//––––––––––––––––––––––––––––––  Private Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]  Moves the transaction on the bus along if the I2CM block has finished with it.
+        A finished write that has a response to read goes to settle, anything else is
+        done. A transfer still running after I2C_TRANSFER_TIMEOUT fails, and the
+        I2CM block is restarted to let go of the bus.
+
+[now] msClockNow() at the call.
+
+[ret]   1 if the bus is free again, 0 if the transfer is still running.
+*/
+uint8 i2cFinishActive(uint32 now) {
+    uint8 status = I2CM_MasterStatus();
+    uint8 finished = !(status & I2CM_MSTAT_XFER_INP)
+            && (status & (I2CM_MSTAT_ERR_XFER | I2CM_MSTAT_RD_CMPLT | I2CM_MSTAT_WR_CMPLT));
+
+    if (!finished) {
+        if (now - i2cActiveSince < I2C_TRANSFER_TIMEOUT) {
+            return 0;
+        }
+        I2CM_Stop();
+        I2CM_Start();
+        i2cActive->status = I2C_STATUS_FAILED;
+    } else if (status & I2CM_MSTAT_ERR_XFER) {
+        i2cActive->status = I2C_STATUS_FAILED;
+    } else if (i2cActive->status == I2C_STATUS_WRITING && i2cActive->response) {
+        /* i2cSchedule() only starts writes with a settling slot free */
+        i2cActive->status = I2C_STATUS_SETTLING;
+        i2cActive->time = now + i2cActive->settleTime;
+        *i2cFreeSettlingSlot() = i2cActive;
+    } else {
+        i2cActive->status = I2C_STATUS_DONE;
+    }
+    i2cActive = NULL;
+    return 1;
+}
+
+
+/*
+[desc]  Picks the client whose transaction goes on the bus next. A transaction that has
+        waited at least its client's maxWait goes first, longest wait first. Otherwise
+        the highest priority class goes, and clients of the same class take turns.
+        Transactions to a slave that is already busy, or that would need a settling
+        slot when none are free, wait.
+
+[now] msClockNow() at the call.
+
+[ret]   The client at the front of whose queue the next transaction is, NULL if none
+        can go.
+*/
+I2cClient* i2cSchedule(uint32 now) {
+    I2cClient* best = NULL;
+    I2cClient* client;
+    I2cTransaction* transaction;
+    uint32 wait, bestWait = 0;
+    uint8 i, index, overdue, bestOverdue = 0, bestIndex = 0;
+    uint8 settlingFree = i2cFreeSettlingSlot() != NULL;
+
+    for (i = 0; i < i2cClientCount; i++) {
+        index = (i2cNextClient + i) % i2cClientCount;
+        client = i2cClients[index];
+        if (client->tail == client->head) {
+            continue;
+        }
+        transaction = client->queue[client->tail & I2C_CLIENT_QUEUE_MASK];
+        if (i2cSlaveBusy(transaction->slaveAddress)
+                || (transaction->command && transaction->response && !settlingFree)) {
+            continue;
+        }
+
+        wait = now - transaction->time;
+        overdue = wait >= client->maxWait;
+        if (best == NULL || (overdue && (!bestOverdue || wait > bestWait))
+                || (!overdue && !bestOverdue && client->priority < best->priority)) {
+            best = client;
+            bestWait = wait;
+            bestOverdue = overdue;
+            bestIndex = index;
+        }
+    }
+
+    if (best) {
+        i2cNextClient = (bestIndex + 1) % i2cClientCount;
+    }
+    return best;
+}
+
+
+/*
+[desc]  Tests whether a slave is on the bus or settling.
+
+[slaveAddress] Address of an I2C device between 0 and 127.
+
+[ret]   1 if the slave is in the middle of a transaction, 0 otherwise.
+*/
+uint8 i2cSlaveBusy(uint8 slaveAddress) {
+    uint8 i;
+    if (i2cActive && i2cActive->slaveAddress == slaveAddress) {
+        return 1;
+    }
+    for (i = 0; i < I2C_MAX_SETTLING; i++) {
+        if (i2cSettling[i] && i2cSettling[i]->slaveAddress == slaveAddress) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/*
+[desc]  Returns a free slot in i2cSettling, or NULL if every slot is taken.
+*/
+I2cTransaction** i2cFreeSettlingSlot(void) {
+    uint8 i;
+    for (i = 0; i < I2C_MAX_SETTLING; i++) {
+        if (i2cSettling[i] == NULL) {
+            return &i2cSettling[i];
+        }
+    }
+    return NULL;
+}
+
+
+/*
+[desc]  Starts one half of a transaction, giving up on the transaction once the I2CM
+        block has refused to start it I2C_BEGIN_RETRIES times.
+
+[transaction] The transaction to start.
+[status] I2C_STATUS_WRITING or I2C_STATUS_READING, as for i2cBegin().
+[now] msClockNow() at the call.
+
+[ret]   1 if the transaction started or failed for good, so it leaves its queue or
+        settling slot, 0 if it should be tried again on the next i2cRun().
+*/
+uint8 i2cTryBegin(I2cTransaction* transaction, uint8 status, uint32 now) {
+    if (i2cBegin(transaction, status, now)) {
+        return 1;
+    }
+    if (++transaction->attempts >= I2C_BEGIN_RETRIES) {
+        transaction->status = I2C_STATUS_FAILED;
+        return 1;
+    }
+    return 0;
+}
+
+
+/*
+[desc]  Hands one half of a transaction to the I2CM block, which runs it from its own
+        interrupt.
+
+[transaction] The transaction to start.
+[status] I2C_STATUS_WRITING to write its command, I2C_STATUS_READING to read its
+        response.
+[now] msClockNow() at the call.
+
+[ret]   1 if the transfer started, 0 if the block is busy and it should be tried
+        again on the next i2cRun().
+*/
+uint8 i2cBegin(I2cTransaction* transaction, uint8 status, uint32 now) {
+    uint8 result;
+
+    I2CM_MasterClearStatus();
+    if (status == I2C_STATUS_WRITING) {
+        result = I2CM_MasterWriteBuf(transaction->slaveAddress, transaction->command,
+                transaction->commandLength, I2CM_MODE_COMPLETE_XFER);
+    } else {
+        result = I2CM_MasterReadBuf(transaction->slaveAddress, transaction->response,
+                transaction->responseLength, I2CM_MODE_COMPLETE_XFER);
+    }
+    if (result != I2CM_MSTR_NO_ERROR) {
+        return 0;
+    }
+    transaction->status = status;
+    transaction->attempts = 0;
+    i2cActive = transaction;
+    i2cActiveSince = now;
+    return 1;
+}
+
+
+/* EOF */
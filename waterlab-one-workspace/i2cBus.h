@@ -0,0 +1,132 @@
+/*
+    Carl Lindquist
+    Oct 17, 2026
+
+    Non-blocking, prioritized I2C transactions for the PSoC 5LP. Assumes an I2C
+    Master hardware block named I2CM, whose own interrupt moves the bytes, and
+    times everything against the shared msClock.
+
+    A transaction writes a command to a slave, waits for the slave to settle,
+    then reads its response. Either half may be left out. The slave is held
+    from the write until the read, so nothing else can talk to it in between,
+    while other slaves keep using the bus.
+
+    Every user of the bus is a client with its own queue and a priority class.
+    When the bus frees up, the oldest transaction of the highest class goes
+    next, taking turns between clients of the same class. A transaction that
+    has waited longer than its client's maxWait goes ahead of every class, so
+    no client starves. A transfer that hangs, for instance on a slave holding
+    SCL low, fails after I2C_TRANSFER_TIMEOUT and the I2CM block is restarted,
+    and one the block won't start fails after I2C_BEGIN_RETRIES tries, so
+    nothing holds the bus forever.
+
+    Buffers belong to the caller and must stay put until the transaction is
+    done. Responses land straight in them, with no copy. Every function here
+    must be called from the same context, normally the main loop, and never
+    from an ISR.
+*/
+
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include "project.h"
+
+
+#define I2C_MAX_CLIENTS 8
+#define I2C_CLIENT_QUEUE_SIZE 4 /* Transactions per client, must be a power of two */
+#define I2C_MAX_SETTLING 8 /* Slaves that can be settling at once */
+#define I2C_TRANSFER_TIMEOUT 100 /* Milliseconds a write or read may take before it fails */
+#define I2C_BEGIN_RETRIES 10 /* Times the I2CM block may refuse to start a transfer before it fails */
+
+
+typedef enum {
+    I2C_PRIORITY_SAFETY, /* Readings the control loop acts on */
+    I2C_PRIORITY_BACKGROUND, /* Routine polling */
+    I2C_PRIORITY_SHELL, /* Interactive setup shell commands */
+    I2C_PRIORITY_COUNT,
+} I2cPriorities;
+
+typedef enum {
+    I2C_STATUS_IDLE, /* Never submitted, or done and looked at */
+    I2C_STATUS_QUEUED,
+    I2C_STATUS_WRITING,
+    I2C_STATUS_SETTLING,
+    I2C_STATUS_READING,
+    I2C_STATUS_DONE,
+    I2C_STATUS_FAILED, /* NAKed, lost arbitration, timed out or never started */
+} I2cStatuses;
+
+typedef struct I2cTransaction {
+    uint8 slaveAddress;
+    uint8* command; /* Written first, NULL to only read */
+    uint8 commandLength;
+    uint8* response; /* Read after settling, NULL to only write */
+    uint8 responseLength;
+    uint16 settleTime; /* Milliseconds between the write and the read */
+    uint8 status; /* An I2cStatus, set by the bus */
+    uint32 time; /* Set by the bus: when it was queued, or when it may be read while settling */
+    uint8 attempts; /* Set by the bus: times the I2CM block refused to start the current half */
+} I2cTransaction;
+
+typedef struct I2cClient {
+    uint8 priority; /* An I2cPriority */
+    uint16 maxWait; /* Milliseconds a transaction may queue before it goes ahead of every class */
+    I2cTransaction* queue[I2C_CLIENT_QUEUE_SIZE];
+    uint8 head; /* Free-running, masked on use */
+    uint8 tail;
+} I2cClient;
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]  Starts the I2CM block and the millisecond clock, and forgets every client.
+*/
+void i2cStart(void);
+
+
+/*
+[desc]  Adds a client to the bus. Call once per client after i2cStart().
+
+[client] The client, which must stay put for as long as the bus runs.
+[priority] An I2cPriority.
+[maxWait] Milliseconds a transaction may queue before it goes ahead of every class.
+
+[ret]   1 on success, 0 if I2C_MAX_CLIENTS clients were already added.
+*/
+uint8 i2cAddClient(I2cClient* client, uint8 priority, uint16 maxWait);
+
+
+/*
+[desc]  Queues a transaction behind the client's others. The transaction must not be
+        queued or in progress already.
+
+[client] The client to queue on.
+[transaction] The transaction. Its status is set to I2C_STATUS_QUEUED.
+
+[ret]   1 if the transaction was queued, 0 if the client's queue is full or the
+        transaction is already in progress.
+*/
+uint8 i2cSubmit(I2cClient* client, I2cTransaction* transaction);
+
+
+/*
+[desc]  Advances the bus. Moves the transaction on the bus along once the I2CM block
+        has finished with it, then starts the read of a slave that has settled, or
+        failing that the next queued transaction. Returns at once either way.
+*/
+void i2cRun(void);
+
+
+/*
+[desc]  Tests whether a transaction is finished, successfully or not.
+
+[transaction] The transaction to test.
+
+[ret]   1 if it is done or failed, 0 otherwise.
+*/
+uint8 i2cFinished(I2cTransaction* transaction);
+
+
+
+#endif /* I2C_BUS_H */
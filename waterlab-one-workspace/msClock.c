@@ -0,0 +1,47 @@
+/*
+    Carl Lindquist
+    Oct 17, 2026
+
+    Shared millisecond clock on the SysTick timer. See msClock.h.
+*/
+
+#include "msClock.h"
+
+
+//––––––  Private Declarations  ––––––//
+
+uint8 msClockStarted;
+volatile uint32 msClockTicks; /* Milliseconds since the first msClockStart() */
+
+void msClockTick(void);
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+void msClockStart(void) {
+    if (msClockStarted) {
+        return;
+    }
+    msClockStarted = TRUE;
+    msClockTicks = 0;
+    CySysTickStart();
+    CySysTickSetCallback(MS_CLOCK_SYSTICK_CALLBACK, msClockTick);
+}
+
+
+uint32 msClockNow(void) {
+    return msClockTicks;
+}
+
+
+//––––––––––––––––––––––––––––––  Private Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]  SysTick callback, runs once a millisecond in interrupt context.
+*/
+void msClockTick(void) {
+    msClockTicks++;
+}
+
+
+/* EOF */
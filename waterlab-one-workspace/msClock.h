@@ -0,0 +1,33 @@
+/*
+    Carl Lindquist
+    Oct 17, 2026
+
+    One millisecond clock for the whole firmware, counted by a SysTick callback.
+    The I2C bus and the Tristar module both time their work against it, so
+    SysTick is started and hooked in exactly one place.
+*/
+
+#ifndef MS_CLOCK_H
+#define MS_CLOCK_H
+    
+#include "project.h"
+
+#define MS_CLOCK_SYSTICK_CALLBACK 0 /* SysTick callback slot used for the clock */
+
+
+//––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]  Starts SysTick and the clock. Every module that uses the clock calls this
+        from its own start function, only the first call does anything.
+*/
+void msClockStart(void);
+
+/*
+[desc]  Returns the milliseconds since the first msClockStart(). Wraps every 49
+        days, so compare times by subtracting them.
+*/
+uint32 msClockNow(void);
+
+
+#endif /* MS_CLOCK_H */
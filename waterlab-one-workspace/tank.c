@@ -11,9 +11,9 @@
     fashion that they become closed (allowing current) when they float, and open
     (stopping current) when they are not floating.
 
-    To avoid floating point errors, you can and should specify the number of tanks
-    you are using (up to a maxiumum of MAX_TANK_COUNT), where each tank has two 
-    float switches.
+    The tanks and their switch pins come from the project's tankConfig.h, see
+    tank.h. The descriptor list is expanded into the pin reads and lookup tables
+    below, so no code changes with the number of tanks.
 
     This library has event-driven and state-based methods.
 */
@@ -21,361 +21,329 @@
 #include "tank.h"
 #include <stdio.h>
 
-#define DEBOUNCE_ARRAY_SIZE (FSWITCH_DEBOUNCE_PERIOD + 2)
-#define NEW (DEBOUNCE_ARRAY_SIZE - 1)
-#define OLD 0
-
-
-typedef enum {
-    FSWITCH_0 = 0x01,
-    FSWITCH_1 = 0x02,
-    FSWITCH_2 = 0x04,
-    FSWITCH_3 = 0x08,
-    FSWITCH_4 = 0x10,
-    FSWITCH_5 = 0x20,
-    FSWITCH_6 = 0x40,
-    FSWITCH_7 = 0x80,
-} FloatSwitchBitmasks;
-
-typedef enum {
-    FSWITCH_EVENT_NONE = 0x00,
-    FSWITCH_EVENT_0_ON = 0x01,
-    FSWITCH_EVENT_0_OFF = 0x02,
-    FSWITCH_EVENT_1_ON = 0x04,
-    FSWITCH_EVENT_1_OFF = 0x08,
-    FSWITCH_EVENT_2_ON = 0x10,
-    FSWITCH_EVENT_2_OFF = 0x20,
-    FSWITCH_EVENT_3_ON = 0x40,
-    FSWITCH_EVENT_3_OFF = 0x80,
-    
-    FSWITCH_EVENT_4_ON = 0x100,
-    FSWITCH_EVENT_4_OFF = 0x200,
-    FSWITCH_EVENT_5_ON = 0x400,
-    FSWITCH_EVENT_5_OFF = 0x800,
-    FSWITCH_EVENT_6_ON = 0x1000,
-    FSWITCH_EVENT_6_OFF = 0x2000,
-    FSWITCH_EVENT_7_ON = 0x4000,
-    FSWITCH_EVENT_7_OFF = 0x8000,
-} FloatSwitchEventFlags;
+/* Bits per vertical counter, enough to count to FSWITCH_DEBOUNCE_PERIOD */
+#if FSWITCH_DEBOUNCE_PERIOD < 2
+    #define FSWITCH_COUNTER_BITS 1
+#elif FSWITCH_DEBOUNCE_PERIOD < 4
+    #define FSWITCH_COUNTER_BITS 2
+#elif FSWITCH_DEBOUNCE_PERIOD < 8
+    #define FSWITCH_COUNTER_BITS 3
+#elif FSWITCH_DEBOUNCE_PERIOD < 16
+    #define FSWITCH_COUNTER_BITS 4
+#else
+    #error "FSWITCH_DEBOUNCE_PERIOD must be less than 16"
+#endif
+
+/* Each tank has its full switch on an even bit and its empty switch on the odd bit
+   above it. That is the TANK_EVENT_EMPTY/_FULL layout swapped, full events being on
+   the odd bit and empty events on the even one, and the shifts in tankCheckEvents()
+   convert between the two. They are not redundant. */
+#define FSWITCH_FULL(tank) ((uint32) 1 << (2 * (tank)))
+#define FSWITCH_EMPTY(tank) ((uint32) 2 << (2 * (tank)))
+#define FSWITCH_FULL_SWITCHES 0x55555555
+#define FSWITCH_EMPTY_SWITCHES 0xAAAAAAAA
+
+/* A missing switch reads as a level matching neither polarity, so it never floats */
+#define FSWITCH_NO_PIN_Read() 2
+#define FSWITCH_NO_PIN_ClearInterrupt()
+
+/* Generators expanded over TANK_DESCRIPTORS */
+#define TANK_ID(tank, fullPin, emptyPin, polarity) tank,
+#define TANK_ID_CHECK(tank, fullPin, emptyPin, polarity) \
+    char id##tank[(tank) < MAX_TANK_COUNT ? 1 : -1]; /* Fails to compile for an id out of range or listed twice */
+#define FSWITCH_READ(tank, fullPin, emptyPin, polarity) \
+    | (fullPin##_Read() == (polarity) ? FSWITCH_FULL(tank) : 0) \
+    | (emptyPin##_Read() == (polarity) ? FSWITCH_EMPTY(tank) : 0)
+#define FSWITCH_CLEAR_EDGES(tank, fullPin, emptyPin, polarity) \
+    fullPin##_ClearInterrupt(); \
+    emptyPin##_ClearInterrupt();
+
+#define TANK_DESCRIPTOR_COUNT (sizeof(tankIds) / sizeof(tankIds[0]))
+
+#define TANK_EVENT_QUEUE_MASK (TANK_EVENT_QUEUE_SIZE - 1)
+
+#if (TANK_EVENT_QUEUE_SIZE & TANK_EVENT_QUEUE_MASK) != 0
+    #error "TANK_EVENT_QUEUE_SIZE must be a power of two"
+#endif
+
+/* Milliseconds for event timestamps. The tick stops between edges when
+   FSWITCH_EDGE_TRIGGERED is defined, so that mode needs a free-running clock
+   from tankConfig.h, for instance msClockNow() from msClock.h. */
+#ifndef TANK_CLOCK_MS
+    #ifdef FSWITCH_EDGE_TRIGGERED
+        #error "FSWITCH_EDGE_TRIGGERED needs TANK_CLOCK_MS() defined in tankConfig.h as a free-running ms clock"
+    #endif
+    #define TANK_CLOCK_MS() tankTicks
+#endif
+
+
+typedef struct TankIdCheck { TANK_DESCRIPTORS(TANK_ID_CHECK) } TankIdCheck;
 
 
 //––––––  Private Declarations  ––––––//
 
-uint16 fswitchGetStates(void);
-uint16 fswitchCheckEvents(void);
-uint8 fswtichEventOccurred(uint16 fsEvent, uint16 fswitchEvents);
+static const uint8 tankIds[] = { TANK_DESCRIPTORS(TANK_ID) };
+
+/* TankState of a tank from its two switch bits, full switch in bit 0 */
+static const uint8 tankStateTable[4] = {
+    TANK_STATE_EMPTY, /* Neither switch floats */
+    TANK_STATE_UNDEF, /* Only the full switch floats */
+    TANK_STATE_MID,
+    TANK_STATE_FULL,
+};
+
+uint32 fswitchStable; /* Debounced switch states */
+uint32 fswitchCount[FSWITCH_COUNTER_BITS]; /* Vertical counters, bit n of every word is switch n's count */
+
+/* Free-running indexes, masked on use. Only the ISR writes queueHead and only
+   tankPollEvent() writes queueTail, so the queue is full when they differ by
+   TANK_EVENT_QUEUE_SIZE. */
+volatile TankEventRecord eventQueue[TANK_EVENT_QUEUE_SIZE];
+volatile uint8 queueHead;
+volatile uint8 queueTail;
+volatile uint32 queueOverflows;
+volatile uint32 tankTicks; /* Milliseconds FSwitch_ISR has run for since tankInit() */
 
-uint8 tankDetermineState(uint8 emptySwitch, uint8 fullSwitch, uint16 fswitchStates);
-uint16 tankCheckEvents(uint16 fswitchEvents);
+uint32 fswitchGetStates(void);
+uint32 fswitchCheckEvents(uint32* falling);
+uint8 fswitchSettled(void);
+
+uint32 tankCheckEvents(uint32 rising, uint32 falling);
+void tankQueueEvents(uint32 events);
 
 CY_ISR_PROTO(FSwitch_ISR);
+#ifdef FSWITCH_EDGE_TRIGGERED
+    void fswitchClearEdges(void);
+    CY_ISR_PROTO(FSwitch_Edge_ISR);
+#endif
 
 
 //––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
 
 void tankInit(void) {
-    FSwitch_Interrupt_StartEx(FSwitch_ISR);
     tankEvents = TANK_EVENT_NONE;
+    queueHead = 0;
+    queueTail = 0;
+    queueOverflows = 0;
+    tankTicks = 0;
+    FSwitch_Interrupt_StartEx(FSwitch_ISR); //Runs at least until the switches first settle
+    #ifdef FSWITCH_EDGE_TRIGGERED
+        fswitchClearEdges();
+        FSwitch_Edge_Interrupt_StartEx(FSwitch_Edge_ISR);
+    #endif
 }
 
 
 tankStruct tankGetStates(void) {
-    uint16 fswitchStates = fswitchGetStates();
+    uint32 fswitchStates = fswitchGetStates();
     tankStruct tankStates = {};
+    uint8 i, tank;
     
-    #ifdef TANK_0_ACTIVE
-        tankStates.tank[0] = tankDetermineState(FSWITCH_1, FSWITCH_0, fswitchStates);
-    #endif
-    
-    #ifdef TANK_1_ACTIVE
-        tankStates.tank[1] = tankDetermineState(FSWITCH_3, FSWITCH_2, fswitchStates);
-    #endif
-    
-    #ifdef TANK_2_ACTIVE
-        tankStates.tank[2] = tankDetermineState(FSWITCH_5, FSWITCH_4, fswitchStates);
-    #endif
-    
-    #ifdef TANK_3_ACTIVE
-        tankStates.tank[3] = tankDetermineState(FSWITCH_7, FSWITCH_6, fswitchStates);
-    #endif
-    
+    for (i = 0; i < TANK_DESCRIPTOR_COUNT; i++) {
+        tank = tankIds[i];
+        tankStates.tank[tank] = tankStateTable[(fswitchStates >> (2 * tank)) & 0x03];
+    }
     return tankStates;
 }
 
 
-uint8 tankEventoccurred(uint16 tankEventFlag) {
+uint8 tankEventOccurred(uint32 tankEventFlag) {
     return ((tankEvents & tankEventFlag) != 0);
 }
 
 
-uint8 tankClearEvent(uint16 tankEventFlag) {
+uint8 tankClearEvent(uint32 tankEventFlag) {
+    uint8 interrupts = CyEnterCriticalSection(); //FSwitch_ISR must not set a bit between the read and the write
     uint8 tmp = ((tankEvents & tankEventFlag) != 0);
     tankEvents &= (~tankEventFlag);
+    CyExitCriticalSection(interrupts);
     return tmp;
 }
 
 
+uint8 tankPollEvent(TankEventRecord* record) {
+    uint8 tail = queueTail;
+    if (tail == queueHead) {
+        return 0;
+    }
+    *record = eventQueue[tail & TANK_EVENT_QUEUE_MASK];
+    queueTail = tail + 1; //Only after the copy, so the ISR can't overwrite the record mid-read
+    return 1;
+}
+
+
+uint32 tankEventOverflows(void) {
+    return queueOverflows;
+}
+
+
 //––––––––––––––––––––––––––––––  Private Functions  ––––––––––––––––––––––––––––––//
 
 /*
-[desc]  Returns the current state of float switches in a uint16 with one-hot encoding.
-        States are represented in the FloatSwitchBitmasks above.
+[desc]  Returns the current state of float switches in a uint32, with each tank's full
+        switch at bit 2 * id and its empty switch at the bit above. A set bit means the
+        switch floats, whatever the pin's polarity.
     
-[ret]   A uint16 representing states of the switches. Use with FloatSwitchBitmasks.
+[ret]   A uint32 representing states of the switches.
 */
-uint16 fswitchGetStates(void) {
-    uint16 state = 0x00;
-    
-    /*  Note that float switches read in backwards with the resistive
-        drain configuration, hence the negation */
-    #ifdef TANK_0_ACTIVE
-        if (!Switch0_In_Pin_Read()) {
-            state |= FSWITCH_0;
-        }
-        if (!Switch1_In_Pin_Read()) {
-            state |= FSWITCH_1;
-        }
-    #endif
-    
-    #ifdef TANK_1_ACTIVE
-        if (!Switch2_In_Pin_Read()) {
-            state |= FSWITCH_2;
-        }
-        if (!Switch3_In_Pin_Read()) {
-            state |= FSWITCH_3;
-        }
-    #endif
-    
-    #ifdef TANK_2_ACTIVE
-        if (!Switch4_In_Pin_Read()) {
-            state |= FSWITCH_4;
-        }
-        if (!Switch5_In_Pin_Read()) {
-            state |= FSWITCH_5;
-        }
-    #endif
-    
-    #ifdef TANK_3_ACTIVE
-        if (!Switch6_In_Pin_Read()) {
-            state |= FSWITCH_6;
-        }
-        if (!Switch7_In_Pin_Read()) {
-            state |= FSWITCH_7;
-        }
-    #endif
-    
-    return state;
+uint32 fswitchGetStates(void) {
+    return 0 TANK_DESCRIPTORS(FSWITCH_READ);
 }
 
 
 /*
-[desc]  Returns a uint16 describing which events have occurred since the last time
-        this function was called. This function has debouncing built in, though
-        it is not strictly necessary in the case of float switches. This means that
-        the function keeps track of states over multiple calls. The 
-        FSWITCH_DEBOUNCE_PERIOD is the number of calls for which a state must be the 
-        same before an event will be recognized.
-
-[ret]   A uint16 representing all the events which have occurred since this function
-        was last called. Use with the FloatSwitchEventFlags bitmasks in this file header.
+[desc]  Debounces every float switch at once and returns the ones that turned on. Each
+        switch has a vertical counter: bit n of every fswitchCount word holds a bit of
+        switch n's count, so a handful of bitwise operations counts all switches in
+        parallel. A switch's count goes up on each call where it reads differently from
+        its debounced state and is cleared when it doesn't. The debounced state flips
+        once the count reaches FSWITCH_DEBOUNCE_PERIOD.
+
+[falling] Set to the switches that turned off, laid out as by fswitchGetStates().
+
+[ret]   The switches that turned on during this call.
 */
-uint16 fswitchCheckEvents(void) {
-    static uint16 states[DEBOUNCE_ARRAY_SIZE];
-    states[NEW] = fswitchGetStates();
-    
-    uint16 events = FSWITCH_EVENT_NONE;
-    
-    /* Shift your old values back for debouncing, check newer states for equality */
-    int eventOccurred = 1;
-    int i, j;
-    for (i = OLD, j = OLD + 2; i < NEW; i++, j++) {
-        if (j < NEW && eventOccurred) {
-            if (states[j] != states[j+1]) { //tests for equality of the newest states
-                eventOccurred = 0;
-            }
-            
-        }
-        states[i] = states[i + 1]; //shift values back, after checking for equality
+uint32 fswitchCheckEvents(uint32* falling) {
+    uint32 delta = fswitchGetStates() ^ fswitchStable;
+    uint32 carry = delta;
+    uint32 flip = delta;
+    uint32 old;
+    uint8 bit;
+
+    for (bit = 0; bit < FSWITCH_COUNTER_BITS; bit++) {
+        old = fswitchCount[bit];
+        fswitchCount[bit] = (old ^ carry) & delta; //Add one where delta is set, clear the rest
+        carry &= old;
+        flip &= (FSWITCH_DEBOUNCE_PERIOD >> bit & 1) ? fswitchCount[bit] : ~fswitchCount[bit];
     }
-
-    if (states[OLD] == states[NEW]) {
-        eventOccurred = 0;
+    for (bit = 0; bit < FSWITCH_COUNTER_BITS; bit++) {
+        fswitchCount[bit] &= ~flip;
     }
-    
-    if (eventOccurred) {
-        
-        /*  FSwitch event checker is split first by tank:
-            TANK_0 has FSWITCH_0 (FULL) and FSWITCH_1 (EMPTY)
-            Then split by going from OFF to ON and vice versa */
-        #ifdef TANK_0_ACTIVE
-            /* Going from OFF to ON */
-            if ( !(states[OLD] & FSWITCH_0) && (states[NEW] & FSWITCH_0) ) {
-                events |= FSWITCH_EVENT_0_ON;
-            }
-            if ( !(states[OLD] & FSWITCH_1) && (states[NEW] & FSWITCH_1) ) {
-                events |= FSWITCH_EVENT_1_ON;
-            }
-            /* Going from ON to OFF */
-            if ( (states[OLD] & FSWITCH_0) && !(states[NEW] & FSWITCH_0) ) {
-            events |= FSWITCH_EVENT_0_OFF;
-            }
-            if ( (states[OLD] & FSWITCH_1) && !(states[NEW] & FSWITCH_1) ) {
-                events |= FSWITCH_EVENT_1_OFF;
-            }
-        #endif
-        
-        #ifdef TANK_1_ACTIVE
-            if ( !(states[OLD] & FSWITCH_2) && (states[NEW] & FSWITCH_2) ) {
-                events |= FSWITCH_EVENT_2_ON;
-            }
-            if ( !(states[OLD] & FSWITCH_3) && (states[NEW] & FSWITCH_3) ) {
-                events |= FSWITCH_EVENT_3_ON;
-            }
-                  
-            if ( (states[OLD] & FSWITCH_2) && !(states[NEW] & FSWITCH_2) ) {
-                events |= FSWITCH_EVENT_2_OFF;
-            }
-            if ( (states[OLD] & FSWITCH_3) && !(states[NEW] & FSWITCH_3) ) {
-                events |= FSWITCH_EVENT_3_OFF;
-            } 
-        #endif
-        
-        #ifdef TANK_2_ACTIVE
-            if ( !(states[OLD] & FSWITCH_4) && (states[NEW] & FSWITCH_4) ) {
-                events |= FSWITCH_EVENT_4_ON;
-            }
-            if ( !(states[OLD] & FSWITCH_5) && (states[NEW] & FSWITCH_5) ) {
-                events |= FSWITCH_EVENT_5_ON;
-            }
-                  
-            if ( (states[OLD] & FSWITCH_4) && !(states[NEW] & FSWITCH_4) ) {
-                events |= FSWITCH_EVENT_4_OFF;
-            }
-            if ( (states[OLD] & FSWITCH_5) && !(states[NEW] & FSWITCH_5) ) {
-                events |= FSWITCH_EVENT_5_OFF;
-            } 
-        #endif
-        
-        #ifdef TANK_3_ACTIVE
-            if ( !(states[OLD] & FSWITCH_6) && (states[NEW] & FSWITCH_6) ) {
-                events |= FSWITCH_EVENT_6_ON;
-            }
-            if ( !(states[OLD] & FSWITCH_7) && (states[NEW] & FSWITCH_7) ) {
-                events |= FSWITCH_EVENT_7_ON;
-            }
-                  
-            if ( (states[OLD] & FSWITCH_6) && !(states[NEW] & FSWITCH_6) ) {
-                events |= FSWITCH_EVENT_6_OFF;
-            }
-            if ( (states[OLD] & FSWITCH_7) && !(states[NEW] & FSWITCH_7) ) {
-                events |= FSWITCH_EVENT_7_OFF;
-            } 
-        #endif
-    }
-    return events;
+
+    fswitchStable ^= flip;
+    *falling = flip & ~fswitchStable;
+    return flip & fswitchStable;
 }
 
 
 /*
-[desc]  Tests whether or not an event has occurred. Avoids the ugly
-        'and-ing' of fswitchEvents and the event in question explicitly.
+[desc]  Tests whether every float switch reads the same as its debounced state, so
+        FSwitch_ISR has nothing left to count.
 
-[fsEvent] A FloatSwitchEventFlag to test the truth of.
-    
-[ret]   1 if the event occurred, 0 otherwise.
+[ret]   1 if no switch is being debounced, 0 otherwise.
 */
-uint8 fswtichEventOccurred(uint16 fsEvent, uint16 fswitchEvents) {
-    return ((fswitchEvents & fsEvent) != 0);
+uint8 fswitchSettled(void) {
+    uint32 counting = 0;
+    uint8 bit;
+    for (bit = 0; bit < FSWITCH_COUNTER_BITS; bit++) {
+        counting |= fswitchCount[bit];
+    }
+    return !counting && fswitchGetStates() == fswitchStable;
 }
 
 
 /*
-[desc]  Helper function for tankGetStates(). Analyzes a single tank's switches
-        and returns its state.
+[desc]  Returns a uint32 describing which tank events the given switch edges cause. A tank
+        is full when its full switch turns on and empty when its empty switch turns off.
+        This function should be called with the edges from fswitchCheckEvents() inside an
+        ISR. To interface with a state machine, this function's return should be stored
+        into a public variable. Note that tankEvents must be cleared externally, they will
+        never clear themselves.
 
-[emptySwitch] The switch associated with a tank becoming empty. A FloatSwitchBitmask.
-[fullSwitch] The switch associated with a tank becoming full. A FloatSwitchBitmask.
-[fswitchStates] A uint16 representing the state of ALL switches. Use fswitchGetStates().
+[rising] Switches that turned on. Use fswitchCheckEvents().
+[falling] Switches that turned off.
 
-[ret]   A TankState (enum in header) representing the state of a tank.
+[ret]   A uint32 representing all the tank events which have occurred since
+        fswitchCheckEvents() was last called. Use with the TankEventFlags bitmasks
+        in this file's header.
 */
-uint8 tankDetermineState(uint8 emptySwitch, uint8 fullSwitch, uint16 fswitchStates) {
-    if ( !(fullSwitch & fswitchStates) && !(emptySwitch & fswitchStates) ) {
-        return TANK_STATE_EMPTY;
-    } else if ( !(fullSwitch & fswitchStates) && (emptySwitch & fswitchStates) ) {
-        return TANK_STATE_MID;
-    } else if ( (fullSwitch & fswitchStates) && (emptySwitch & fswitchStates) ) {
-        return TANK_STATE_FULL;
-    } else {
-        return TANK_STATE_UNDEF;
-    }
+uint32 tankCheckEvents(uint32 rising, uint32 falling) {
+    /* The full switch sits one bit below its TANK_EVENT_n_FULL flag and the empty
+       switch one bit above its TANK_EVENT_n_EMPTY flag */
+    return ((rising & FSWITCH_FULL_SWITCHES) << 1) | ((falling & FSWITCH_EMPTY_SWITCHES) >> 1);
 }
 
 
 /*
-[desc]  Returns a uint16 describing which events have occurred since the last time
-        tankEvents was cleared. This function should be called with fswitchCheckEvents()
-        as its argument inside an ISR. To interface with a state machine, this function's
-        return should be stored into a public variable. Note that tankEvents must be cleared
-        externally, they will never clear themselves.
-
-[fswitchEvents] The float switch events used to determine check events. This must adhere
-                to a specific enum format for bitmasking. Use fswitchCheckEvents().
+[desc]  Adds a record to the event queue for every event given, lowest tank first.
+        Events that don't fit are counted in queueOverflows. Must only be called from
+        FSwitch_ISR, the queue's only producer.
 
-[ret]   A uint16 representing all the tank events which have occurred since
-        fswitchCheckEvents() was last called. Use with the TankEventFlags bitmasks
-        in this file's header.
+[events] TankEventFlags from tankCheckEvents().
 */
-uint16 tankCheckEvents(uint16 fswitchEvents) {
-    uint16 events = TANK_EVENT_NONE;
-    
-    #ifdef TANK_0_ACTIVE
-        if (fswtichEventOccurred(FSWITCH_EVENT_0_ON, fswitchEvents)) {
-            events |= TANK_EVENT_0_FULL;
-        }
-        if (fswtichEventOccurred(FSWITCH_EVENT_1_OFF, fswitchEvents)) {
-            events |= TANK_EVENT_0_EMPTY;
-        }
-    #endif
-    
-    #ifdef TANK_1_ACTIVE
-        if (fswtichEventOccurred(FSWITCH_EVENT_2_ON, fswitchEvents)) {
-            events |= TANK_EVENT_1_FULL;
+void tankQueueEvents(uint32 events) {
+    uint8 head = queueHead;
+    uint8 bit;
+    volatile TankEventRecord* record;
+
+    for (bit = 0; events != 0; bit++, events >>= 1) {
+        if (!(events & 1)) {
+            continue;
         }
-        if (fswtichEventOccurred(FSWITCH_EVENT_3_OFF, fswitchEvents)) {
-            events |= TANK_EVENT_1_EMPTY;
+        if ((uint8)(head - queueTail) >= TANK_EVENT_QUEUE_SIZE) {
+            queueOverflows++;
+            continue;
         }
-    #endif
-    
-    #ifdef TANK_2_ACTIVE
-        if (fswtichEventOccurred(FSWITCH_EVENT_4_ON, fswitchEvents)) {
-            events |= TANK_EVENT_2_FULL;
-        }
-        if (fswtichEventOccurred(FSWITCH_EVENT_5_OFF, fswitchEvents)) {
-            events |= TANK_EVENT_2_EMPTY;
-        }
-    #endif
-    
-    #ifdef TANK_3_ACTIVE
-        if (fswtichEventOccurred(FSWITCH_EVENT_6_ON, fswitchEvents)) {
-            events |= TANK_EVENT_3_FULL;
-        }
-        if (fswtichEventOccurred(FSWITCH_EVENT_7_OFF, fswitchEvents)) {
-            events |= TANK_EVENT_3_EMPTY;
+        record = &eventQueue[head & TANK_EVENT_QUEUE_MASK];
+        record->timestamp = TANK_CLOCK_MS();
+        record->tank = bit / 2; //Two flags per tank, see TankEventFlags
+        record->event = (uint32) 1 << bit;
+        head++;
+    }
+    queueHead = head; //Publishes the records only once they are written
+}
+
+
+/*
+[desc]  ISR which buffers events into the tankEvents variable and the event queue.
+        Note that tankEvents must be cleared external to this library by setting
+        tankEvents = TANK_EVENT_NONE or with tankClearEvent().
+*/
+CY_ISR(FSwitch_ISR) {
+    uint32 falling;
+    uint32 rising = fswitchCheckEvents(&falling);
+    uint32 events = tankCheckEvents(rising, falling);
+    tankTicks++;
+    tankEvents |= events;
+    if (events) {
+        tankQueueEvents(events);
+    }
+
+    #ifdef FSWITCH_EDGE_TRIGGERED
+        if (fswitchSettled()) {
+            FSwitch_Interrupt_Disable();
+            /* An edge between the check and the disable would otherwise be missed
+               if FSwitch_Edge_ISR has the higher priority */
+            if (!fswitchSettled()) {
+                FSwitch_Interrupt_Enable();
+            }
         }
     #endif
-        
-    return events;
 }
 
 
+#ifdef FSWITCH_EDGE_TRIGGERED
+
 /*
-[desc]  ISR which buffers events into the tankEvents variable. Note that tankEvents
-        must be cleared external to this library by setting tankEvents = TANK_EVENT_NONE.
+[desc]  Clears the pending edge of every active float switch pin. Pins on the same port
+        share a status register, so clearing one clears them all, but the switches may
+        be spread over several ports.
 */
-CY_ISR(FSwitch_ISR) {
-    tankEvents |= tankCheckEvents(fswitchCheckEvents());
+void fswitchClearEdges(void) {
+    TANK_DESCRIPTORS(FSWITCH_CLEAR_EDGES)
 }
 
 
+/*
+[desc]  ISR for an edge on any float switch pin. Starts the debounce tick, which stops
+        itself in FSwitch_ISR once the switches settle.
+*/
+CY_ISR(FSwitch_Edge_ISR) {
+    fswitchClearEdges();
+    FSwitch_Interrupt_Enable();
+}
+
+#endif /* FSWITCH_EDGE_TRIGGERED */
+
+
 /* EOF */
\ No newline at end of file
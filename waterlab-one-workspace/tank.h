@@ -11,26 +11,59 @@
     fashion that they become closed (allowing current) when they float, and open
     (stopping current) when they are not floating.
 
-    To avoid floating point errors, you can and should specify the number of tanks
-    you are using (up to a maxiumum of MAX_TANK_COUNT), where each tank has two 
-    float switches.
-
-    This library has event-driven and state-based methods.
+    Tanks are described at compile time in the project's own tankConfig.h, which
+    defines MAX_TANK_COUNT and lists every tank's switches in TANK_DESCRIPTORS:
+
+        #define MAX_TANK_COUNT 2
+        #define TANK_DESCRIPTORS(TANK) \
+            TANK(0, Switch0_In_Pin, Switch1_In_Pin, FSWITCH_ACTIVE_LOW) \
+            TANK(1, Switch2_In_Pin, FSWITCH_NO_PIN, FSWITCH_ACTIVE_LOW)
+
+    Each entry is the tank's id, the Pins component of its full (top) switch,
+    that of its empty (bottom) switch, and the pin level of a floating switch.
+    Ids run from 0 to MAX_TANK_COUNT - 1, and a tank missing from the list always
+    reads TANK_STATE_EMPTY. FSWITCH_NO_PIN stands in for a switch a tank doesn't
+    have, which then never floats. Events for up to 16 tanks fit in tankEvents.
+
+    This library has event-driven and state-based methods. Events are kept two
+    ways: as bits ORed into tankEvents, and as timestamped records in a queue
+    that keeps every transition in order. The queue has a single producer, the
+    float switch ISR, and a single consumer, the control loop, so neither side
+    needs to disable interrupts.
+
+    Float switches are debounced by FSwitch_Interrupt, a 1 kHz tick. By default
+    the tick runs all the time. With FSWITCH_EDGE_TRIGGERED defined it is started
+    by an edge on any switch pin and stops once every switch has settled, so the
+    CPU can sleep between level changes. That mode needs the switch pins'
+    interrupts set to both edges and wired to an isr named FSwitch_Edge_Interrupt.
 */
 
 #ifndef TANK_H
 #define TANK_H
     
 #include "project.h"
+#include "tankConfig.h"
+
+
+#ifndef FSWITCH_DEBOUNCE_PERIOD
+    #define FSWITCH_DEBOUNCE_PERIOD 4 /* Milliseconds */
+#endif
+/* Neither schematic has FSwitch_Edge_Interrupt or both-edge switch pins, so this
+   mode has never been built for hardware. It also needs TANK_CLOCK_MS, see tank.c. */
+//#define FSWITCH_EDGE_TRIGGERED /* Debounce only after a switch pin edge, see above, or define in tankConfig.h */
+#define TANK_EVENT_QUEUE_SIZE 32 /* Records, must be a power of two */
+
+#if MAX_TANK_COUNT > 16
+    #error "tankEvents holds two events for each of at most 16 tanks"
+#endif
 
+/* Pin levels of a floating switch, for TANK_DESCRIPTORS */
+#define FSWITCH_ACTIVE_LOW 0 /* Resistive drain, the pin is pulled low when the switch floats */
+#define FSWITCH_ACTIVE_HIGH 1
 
-#define TANK_0_ACTIVE
-#define TANK_1_ACTIVE
-#define TANK_2_ACTIVE
-#define TANK_3_ACTIVE
-  
-#define MAX_TANK_COUNT 4
-#define FSWITCH_DEBOUNCE_PERIOD 4 /* Milliseconds */
+/* Event flags of any tank. TankEventFlags names the first four. */
+#define TANK_EVENT_EMPTY(tank) ((uint32) 1 << (2 * (tank)))
+#define TANK_EVENT_FULL(tank) ((uint32) 2 << (2 * (tank)))
     
 
 typedef struct tankStruct { uint8 tank[MAX_TANK_COUNT]; } tankStruct;
@@ -54,7 +87,13 @@ typedef enum {
     TANK_EVENT_3_FULL = 0x80,
 } TankEventFlags;
 
-uint16 tankEvents;
+typedef struct TankEventRecord {
+    uint32 timestamp; /* Milliseconds from TANK_CLOCK_MS, see tank.c */
+    uint8 tank;
+    uint32 event; /* A single TankEventFlag */
+} TankEventRecord;
+
+uint32 tankEvents;
 
 
 //––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
@@ -89,7 +128,7 @@ tankStruct tankGetStates(void);
     
 [ret]   1 if the event occurred, 0 otherwise.
 */
-uint8 tankEventOccurred(uint16 tankEventFlag);
+uint8 tankEventOccurred(uint32 tankEventFlag);
 
 
 /*
@@ -100,7 +139,28 @@ uint8 tankEventOccurred(uint16 tankEventFlag);
     
 [ret]   1 if the event occurred, 0 otherwise.
 */
-uint8 tankClearEvent(uint16 tankEventFlag);
+uint8 tankClearEvent(uint32 tankEventFlag);
+
+
+/*
+[desc]  Takes the oldest record from the tank event queue. Events come out in the
+        order they happened, one record per transition. Must only be called from
+        the control loop, never from an ISR.
+
+[record] Filled with the oldest event when there is one.
+    
+[ret]   1 if a record was taken, 0 if the queue is empty.
+*/
+uint8 tankPollEvent(TankEventRecord* record);
+
+
+/*
+[desc]  Returns the number of events dropped because the queue was full when they
+        happened. Those events are still ORed into tankEvents.
+    
+[ret]   Events dropped since tankInit().
+*/
+uint32 tankEventOverflows(void);
 
 
 
@@ -2,12 +2,16 @@
     Carl Lindquist
     June 1, 2017
 
+    Requests wait in a queue and go out one at a time, since the Tristar only
+    answers one at a time. RX_ISR frames the reply into dfltPacketBuffer and
+    raises packetReady, and tstarRun() decodes it in the main loop.
 */
 #include "tristarProtocol.h"
 
 #include <string.h>
 #include <stdio.h>
 #include "usbProtocol.h"
+#include "msClock.h"
 
 #define TRUE 1
 #define FALSE 0
@@ -21,6 +25,29 @@
 #define DFLT_TSTAR_ADDRESS 0x01
 #define TSTAR_VALUE_SCALAR 32768
 
+#define TSTAR_QUEUE_MASK (TSTAR_QUEUE_SIZE - 1)
+#define TSTAR_POLL_PERIOD 1000 /* Milliseconds between refreshes of the live registers */
+#define TSTAR_RESPONSE_TIMEOUT 500 /* Milliseconds to wait for a reply */
+#define TSTAR_FRAME_GAP 5 /* Milliseconds of silence between frames, at least 3.5 characters */
+#define MODBUS_EXCEPTION 0x80 /* Set in the function code of a refusal */
+
+/* Input registers from the Tristar Comm Document */
+#define TSTAR_SCALING_REG 0x00 /* Voltage then current scaling, each an integer then a fractional part */
+#define TSTAR_SCALING_COUNT 4
+#define TSTAR_LIVE_REG 0x18 /* First register of the block refreshed every TSTAR_POLL_PERIOD */
+#define TSTAR_BATT_VOLT_REG 0x18
+#define TSTAR_PV_VOLT_REG 0x1B
+#define TSTAR_PV_CURRENT_REG 0x1D
+#define TSTAR_HEATSINK_TEMP_REG 0x23
+#define TSTAR_CHARGE_STATE_REG 0x32
+#define TSTAR_LIVE_COUNT (TSTAR_CHARGE_STATE_REG - TSTAR_LIVE_REG + 1)
+
+#define LIVE_REGISTER(reg) (liveRegisters[(reg) - TSTAR_LIVE_REG])
+
+#if (TSTAR_QUEUE_SIZE & TSTAR_QUEUE_MASK) != 0
+    #error "TSTAR_QUEUE_SIZE must be a power of two"
+#endif
+
 static const uint16 crc16Table[] = {
    0X0000, 0XC0C1, 0XC181, 0X0140, 0XC301, 0X03C0, 0X0280, 0XC241,
    0XC601, 0X06C0, 0X0780, 0XC741, 0X0500, 0XC5C1, 0XC481, 0X0440,
@@ -72,24 +99,41 @@ enum expectedPackets {
 uint8 debug;
 uint8 tstarAddress;
 uint8 activeAddress;
-uint8 packetReady;
+volatile uint8 packetReady;
 uint8 dfltPacketBuffer[BUFFER_SIZE] = {};
 uint16 packetLength;
 
-/*Unused. Further development should automatically gather data every so often
-to avoid blocking calls to battVolt. An interrupt should collet voltage, store
-it in this var. Then when the user call battVolt, simply return this var. */
-//double recentBattVolt;
+TstarRequest* requestQueue[TSTAR_QUEUE_SIZE];
+uint8 queueHead; /* Free-running, masked on use */
+uint8 queueTail;
+TstarRequest* activeRequest; /* The request waiting for its reply, NULL if none */
+uint32 lastActivity; /* When the bus last went quiet */
+uint32 lastPoll;
+
+/* Register cache, raw registers straight from the Tristar */
+uint16 scalingRegisters[TSTAR_SCALING_COUNT];
+uint16 liveRegisters[TSTAR_LIVE_COUNT];
+uint32 liveUpdatedAt; /* When liveRegisters last arrived */
+uint8 liveValid; /* Whether liveRegisters has arrived at all */
 
 
 //––––––  Private Declarations  ––––––//
 CY_ISR_PROTO(RX_ISR);
+void tstarSend(TstarRequest* request, uint32 now);
+uint8 tstarParseReply(TstarRequest* request);
+void tstarFinish(uint8 status, uint32 now);
+void tstarLiveArrived(TstarRequest* request);
+double tstarScale(uint16 value, const uint16 scaling[]);
 uint8 tstarSendData(uint8 function, uint8 data[], uint8 length);
-void tstarRequest(uint8 function, uint8 data[], uint8 length);
 void sendMBUSFrame(uint8 address, uint8 function, uint8 data[], uint16 length);
 uint16 generateCRC16(const uint8 data[], uint16 length);
 uint64 hexToDecimal(uint8 hex[], uint16 length);
 
+TstarRequest scalingRead = {READ_INPUT_REG, TSTAR_SCALING_REG, TSTAR_SCALING_COUNT, scalingRegisters, NULL,
+        TSTAR_STATUS_IDLE, 0};
+TstarRequest liveRead = {READ_INPUT_REG, TSTAR_LIVE_REG, TSTAR_LIVE_COUNT, liveRegisters, tstarLiveArrived,
+        TSTAR_STATUS_IDLE, 0};
+
 
 //––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
 
@@ -99,65 +143,193 @@ void tstarStart(void) {
     activeAddress = tstarAddress;
     rxMode = RX_MODE_NORMAL;
     debug = TRUE;
-    packetReady = TRUE;
+    packetReady = FALSE;
+    queueHead = 0;
+    queueTail = 0;
+    activeRequest = NULL;
+    msClockStart();
+    lastActivity = msClockNow();
+    lastPoll = msClockNow() - TSTAR_POLL_PERIOD; /* Poll at once */
+    liveValid = FALSE;
     
     MBUS_UART_Start();
     Rx_Interrupt_StartEx(RX_ISR);
+    tstarSubmit(&scalingRead); /* The scaling never changes, so it is read once */
 }
 
 
-double tstarBattVolt(void) {
-    uint8 data[4] = {0x00,0x18,0x00,0x01};
-    uint8 temp[4] = {};
+void tstarRun(void) {
+    uint32 now = msClockNow();
     
-    tstarRequest(READ_INPUT_REG, data, 4);
-    memcpy(temp, &dfltPacketBuffer[PACKET_DATA_INDEX], 2);
-    uint16 volt = hexToDecimal(temp, 2);
+    if (now - lastPoll >= TSTAR_POLL_PERIOD) {
+        lastPoll = now;
+        if (scalingRead.status == TSTAR_STATUS_FAILED) {
+            tstarSubmit(&scalingRead);
+        }
+        tstarSubmit(&liveRead); /* Refused while the last refresh is in progress */
+    }
+    
+    if (activeRequest) {
+        if (packetReady) {
+            tstarFinish(tstarParseReply(activeRequest) ? TSTAR_STATUS_DONE : TSTAR_STATUS_FAILED, now);
+        } else if (now - activeRequest->time >= TSTAR_RESPONSE_TIMEOUT) {
+            usbLog("TSTAR", "Warning: Tristar request timed out");
+            tstarFinish(TSTAR_STATUS_FAILED, now);
+        } else {
+            return; /* Still waiting */
+        }
+    }
     
-    data[1] = 0x00; //Start address
-    data[3] = 0x02; //Num registers to read
-    tstarRequest(READ_INPUT_REG, data, 4);
-    memcpy(temp, &dfltPacketBuffer[PACKET_DATA_INDEX], 4);
-    /* temp[0-1] is integer component, temp[2-3] is fractional component */
-    double scalar = (double)hexToDecimal(temp, 2) + (double)hexToDecimal(&temp[2], 2)/65536;
-    return (volt*scalar)/ TSTAR_VALUE_SCALAR; // This magic number is from the Tristar Comm Document
+    if (queueTail != queueHead && now - lastActivity >= TSTAR_FRAME_GAP) {
+        tstarSend(requestQueue[queueTail++ & TSTAR_QUEUE_MASK], now);
+    }
+}
+
+
+uint8 tstarSubmit(TstarRequest* request) {
+    uint8 status = request->status;
+    if ((uint8)(queueHead - queueTail) >= TSTAR_QUEUE_SIZE || request->count == 0
+            || request->count > TSTAR_MAX_REGISTERS
+            || (status != TSTAR_STATUS_IDLE && status != TSTAR_STATUS_DONE && status != TSTAR_STATUS_FAILED)) {
+        return 0;
+    }
+    request->status = TSTAR_STATUS_QUEUED;
+    requestQueue[queueHead++ & TSTAR_QUEUE_MASK] = request;
+    return 1;
+}
+
+
+uint8 tstarFinished(TstarRequest* request) {
+    return request->status == TSTAR_STATUS_DONE || request->status == TSTAR_STATUS_FAILED;
+}
+
+
+double tstarBattVolt(void) {
+    return tstarScale(LIVE_REGISTER(TSTAR_BATT_VOLT_REG), &scalingRegisters[0]);
+}
+
+
+double tstarPVVolt(void) {
+    return tstarScale(LIVE_REGISTER(TSTAR_PV_VOLT_REG), &scalingRegisters[0]);
 }
 
 
 double tstarPVCurrent(void) {
-    uint8 data[4] = {0x00,0x1D,0x00,0x01};
-    uint8 temp[4] = {};
+    return tstarScale(LIVE_REGISTER(TSTAR_PV_CURRENT_REG), &scalingRegisters[2]);
+}
+
+
+int16 tstarHeatsinkTemp(void) {
+    return (int16) LIVE_REGISTER(TSTAR_HEATSINK_TEMP_REG);
+}
+
+
+uint8 tstarChargeState(void) {
+    return LIVE_REGISTER(TSTAR_CHARGE_STATE_REG);
+}
+
+
+uint32 tstarDataAge(void) {
+    return liveValid ? msClockNow() - liveUpdatedAt : TSTAR_NEVER_UPDATED;
+}
+
+//––––––––––––––––––––––––––––––  Private Functions  ––––––––––––––––––––––––––––––//
+
+/*
+[desc]  Callback of the live register block read, which stamps the cache.
+
+[request] The block read.
+*/
+void tstarLiveArrived(TstarRequest* request) {
+    if (request->status == TSTAR_STATUS_DONE) {
+        liveUpdatedAt = msClockNow();
+        liveValid = TRUE;
+    }
+}
+
+
+/*
+[desc]  Sends a request's frame and makes it the request waiting for a reply.
+
+[request] The request to send.
+[now] msClockNow() at the call.
+*/
+void tstarSend(TstarRequest* request, uint32 now) {
+    uint16 second = request->function == WRITE_SINGLE_REG ? request->registers[0] : request->count;
+    uint8 data[4] = {request->startRegister >> 8, request->startRegister & 0xFF, second >> 8, second & 0xFF};
     
-    tstarRequest(READ_INPUT_REG, data, 4);
-    memcpy(temp, &dfltPacketBuffer[PACKET_DATA_INDEX], 2);
-    uint16 current = hexToDecimal(temp, 2);
+    activeRequest = request;
+    request->time = now;
+    packetReady = FALSE;
+    if (tstarSendData(request->function, data, 4)) {
+        request->status = TSTAR_STATUS_SENT;
+    } else {
+        tstarFinish(TSTAR_STATUS_FAILED, now);
+    }
+}
+
+
+/*
+[desc]  Checks the frame in dfltPacketBuffer answers a request, and copies the
+        registers of a read into the request.
+
+[request] The request that was sent.
+
+[ret]   1 if the reply is good, 0 if it is for something else or is a refusal.
+*/
+uint8 tstarParseReply(TstarRequest* request) {
+    uint8 i;
     
-    data[1] = 0x02; //Start address
-    data[3] = 0x02; //Num registers to read
-    tstarRequest(READ_INPUT_REG, data, 4);
-    memcpy(temp, &dfltPacketBuffer[PACKET_DATA_INDEX], 4);
-    /* temp[0-1] is integer component, temp[2-3] is fractional component */
-    double scalar = (double)hexToDecimal(temp, 2) + (double)hexToDecimal(&temp[2], 2)/65536;
-    return (current*scalar)/ TSTAR_VALUE_SCALAR; // This magic number is from the Tristar Comm Document
+    if (dfltPacketBuffer[0] != tstarAddress || dfltPacketBuffer[1] != request->function) {
+        if (dfltPacketBuffer[1] == (request->function | MODBUS_EXCEPTION)) {
+            usbLog("TSTAR", "Warning: Tristar refused a request");
+        }
+        return 0;
+    }
+    if (request->function == WRITE_SINGLE_REG) {
+        return 1; /* The reply echoes the request */
+    }
+    if (dfltPacketBuffer[2] != 2 * request->count) {
+        return 0;
+    }
+    for (i=0; i < request->count; i++) {
+        request->registers[i] = hexToDecimal(&dfltPacketBuffer[PACKET_DATA_INDEX + 2*i], 2);
+    }
+    return 1;
 }
 
-//––––––––––––––––––––––––––––––  Private Functions  ––––––––––––––––––––––––––––––//
 
 /*
-[desc]  Main method for requesting data from the Tristar. This function will block until
-        incoming packets are finished, then send your request, and continue to wait until a 
-        successful response has come back. NOTE: this function will permamnently block
-        if an invalid packet is received, and a valid one does not arrive.
+[desc]  Finishes the request waiting for a reply and calls its callback.
 
-[function] A MODBUS function code for a server request. Use the MODBUS_FUNCTION_CODES enum.
-[data] The data to be sent in the frame.
-[length] Length of the data to be sent.
+[status] TSTAR_STATUS_DONE or TSTAR_STATUS_FAILED.
+[now] msClockNow() at the call.
 */
-void tstarRequest(uint8 function, uint8 data[], uint8 length) {
-    while(!packetReady); // Wait for incoming packets to finish
+void tstarFinish(uint8 status, uint32 now) {
+    TstarRequest* request = activeRequest;
+    
+    activeRequest = NULL;
     packetReady = FALSE;
-    tstarSendData(function, data, length);
-    while(!packetReady); // Wait for your new packet to finish
+    lastActivity = now;
+    request->status = status;
+    if (request->callback) {
+        request->callback(request);
+    }
+}
+
+
+/*
+[desc]  Converts a raw Tristar register to its real value.
+
+[value] The register.
+[scaling] The scaling registers for its kind of value. [0] is the integer component,
+          [1] the fractional component.
+
+[ret]   The real value.
+*/
+double tstarScale(uint16 value, const uint16 scaling[]) {
+    double scalar = (double)scaling[0] + (double)scaling[1]/65536;
+    return (value*scalar)/ TSTAR_VALUE_SCALAR; // This magic number is from the Tristar Comm Document
 }
 
 
@@ -288,6 +460,11 @@ CY_ISR(RX_ISR) {
             
             if (rxCount == 2) { //MBUS RTU server packets always hold the (packet length-2) remaining in this spot
                 bytesRemaining = byte + CRC_LENGTH;
+                if (rxBuffer[1] & MODBUS_EXCEPTION) { //Except refusals, which hold the exception code here
+                    bytesRemaining = CRC_LENGTH;
+                } else if (rxBuffer[1] == WRITE_SINGLE_REG) { //And echoed writes, which hold the register
+                    bytesRemaining = 3 + CRC_LENGTH;
+                }
             }
             rxBuffer[rxCount++] = byte;
             
@@ -5,6 +5,21 @@
     Module for interfacing the PSoC 5LP with the Morningstar Tristar MPPT 45 solar
     charge controller. This module outputs to a UART shifter, external hardware
     must shift the voltages to the RS-232 standard.
+
+    Requests to the Tristar are queued and answered without blocking. tstarRun(),
+    called from the main loop, sends the next queued request once the last one
+    is answered or timed out. The UART's interrupts move the bytes, RX_ISR frames
+    the reply, and tstarRun() copies its registers into the request's result
+    slot and calls the request's callback, if it has one.
+
+    The Tristar's readings are kept in a register cache. Its scaling registers
+    are read once, at tstarStart(), and its live registers, from the battery
+    voltage to the charge state, are refreshed by tstarRun() with one block read
+    every second. The accessors below only read the cache, so they never wait
+    on the Tristar, and tstarDataAge() tells how old the cache is.
+
+    The MBUS_UART TX buffer must hold a whole request frame, 8 bytes, so sending
+    one only fills the buffer.
 */
 #ifndef TRISTAR_PROTOCOL_H
 #define TRISTAR_PROTOCOL_H
@@ -27,6 +42,42 @@ enum MODBUS_FUNCTION_CODES {
     READ_DEVICE_ID = 0x2B,
 };
 
+#define TSTAR_QUEUE_SIZE 8 /* Requests, must be a power of two */
+#define TSTAR_MAX_REGISTERS 125 /* Most registers a Modbus read returns */
+#define TSTAR_NEVER_UPDATED 0xFFFFFFFF /* tstarDataAge() before the first refresh */
+
+/* Values of tstarChargeState(), from the Tristar Comm Document */
+typedef enum {
+    TSTAR_CHARGE_START,
+    TSTAR_CHARGE_NIGHT_CHECK,
+    TSTAR_CHARGE_DISCONNECT,
+    TSTAR_CHARGE_NIGHT,
+    TSTAR_CHARGE_FAULT,
+    TSTAR_CHARGE_MPPT,
+    TSTAR_CHARGE_ABSORPTION,
+    TSTAR_CHARGE_FLOAT,
+    TSTAR_CHARGE_EQUALIZE,
+    TSTAR_CHARGE_SLAVE,
+} TstarChargeStates;
+
+typedef enum {
+    TSTAR_STATUS_IDLE, /* Never submitted, or done and looked at */
+    TSTAR_STATUS_QUEUED,
+    TSTAR_STATUS_SENT,
+    TSTAR_STATUS_DONE,
+    TSTAR_STATUS_FAILED, /* Timed out, corrupted or refused by the Tristar */
+} TstarStatuses;
+
+typedef struct TstarRequest {
+    uint8 function; /* READ_HOLD_REG, READ_INPUT_REG or WRITE_SINGLE_REG */
+    uint16 startRegister; /* Zero based Modbus address of the first register */
+    uint8 count; /* Registers to read, up to TSTAR_MAX_REGISTERS, 1 for a write */
+    uint16* registers; /* Filled by a read, holds the value to write for a write */
+    void (*callback)(struct TstarRequest* request); /* Called by tstarRun() when finished, NULL for none */
+    uint8 status; /* A TstarStatus, set by this module */
+    uint32 time; /* Set by this module: when the request was sent */
+} TstarRequest;
+
     
 //––––––––––––––––––––––––––––––  Public Functions  ––––––––––––––––––––––––––––––//
 
@@ -37,18 +88,83 @@ enum MODBUS_FUNCTION_CODES {
 void tstarStart(void);
 
 /*
-[desc]  Returns the battery voltage as measured by the Tristar MMPT. Blocking.
+[desc]  Moves requests along: finishes the request in flight once its reply arrives
+        or it times out, and sends the next queued request. Once a second it
+        queues the block read that refreshes the live registers, and queues the
+        scaling read again if the one from tstarStart() failed. Never blocks.
+        Call it often from the main loop, never from an ISR.
+*/
+void tstarRun(void);
+
+
+/*
+[desc]  Queues a request for the Tristar. The request must not be queued or in
+        flight already, and it and its registers must stay put until it finishes.
+
+[request] The request. Its status is set to TSTAR_STATUS_QUEUED.
+
+[ret]   1 if the request was queued, 0 if the queue is full or the request is
+        already in progress.
+*/
+uint8 tstarSubmit(TstarRequest* request);
+
+
+/*
+[desc]  Tests whether a request is finished, successfully or not.
+
+[request] The request to test.
+
+[ret]   1 if it is done or failed, 0 otherwise.
+*/
+uint8 tstarFinished(TstarRequest* request);
+
+/*
+[desc]  Returns the battery voltage as most recently measured by the Tristar MMPT.
+        Non-blocking, 0 until the Tristar first answers.
 
 [ret]   The battery voltage.
 */
 double tstarBattVolt(void);
 
 /*
-[desc]  Returns the pv current as measured by the Tristar MMPT. Blocking.
+[desc]  Returns the pv voltage as most recently measured by the Tristar MMPT.
+        Non-blocking, 0 until the Tristar first answers.
+
+[ret]   The PV panel voltage.
+*/
+double tstarPVVolt(void);
+
+/*
+[desc]  Returns the pv current as most recently measured by the Tristar MMPT.
+        Non-blocking, 0 until the Tristar first answers.
 
 [ret]   The PV panel current.
 */
 double tstarPVCurrent(void);
 
+/*
+[desc]  Returns the heatsink temperature as most recently measured by the Tristar
+        MMPT. Non-blocking, 0 until the Tristar first answers.
+
+[ret]   The heatsink temperature in degrees C.
+*/
+int16 tstarHeatsinkTemp(void);
+
+/*
+[desc]  Returns the Tristar MMPT's charge state when it last answered. Non-blocking,
+        TSTAR_CHARGE_START until the Tristar first answers.
+
+[ret]   A TstarChargeState.
+*/
+uint8 tstarChargeState(void);
+
+/*
+[desc]  Returns how old the cached readings are.
+
+[ret]   Milliseconds since the live registers last arrived, TSTAR_NEVER_UPDATED if
+        they never have.
+*/
+uint32 tstarDataAge(void);
+
     
 #endif /* TRISTAR_PROTOCOL_H */
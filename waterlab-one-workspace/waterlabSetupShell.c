@@ -100,7 +100,8 @@ uint8 runCommand(void) {
     char command[COMMAND_LENGTH] = {};
     char argument[ARGUMENT_LENGTH] = {};
     arrStruct response = {};
-    static uint8 activeDevice = EC_SENSOR_ADDRESS;
+    static uint8 activeDevice = 0; /* Index into EZO_SENSORS */
+    const EzoSensor* sensor = ezoSensor(activeDevice);
     uint8 ret = 1;
     
     if (sscanf(buffer, "%s", command)) {
@@ -108,11 +109,8 @@ uint8 runCommand(void) {
                 
             case HELP:
                 usbSendString("\r  Active Device: ");
-                if (activeDevice == EC_SENSOR_ADDRESS) {
-                    usbSendString("Electrical Conductivity Sensor");
-                } else {
-                    usbSendString("Dissolved Oxygen Sensor");
-                }
+                usbSendString((char*) ezoTypeName(sensor->type));
+                usbSendString(" Sensor");
                 
                 usbSendString("\r  Valid commands:");
                 usbSendString("\r    send [command]");
@@ -126,7 +124,7 @@ uint8 runCommand(void) {
                 usbSendString("\r      Enables/disables autopolling for data.");
                 
                 usbSendString("\r    change_active_device");
-                usbSendString("\r      Toggles the 'Active Device'.");
+                usbSendString("\r      Makes the next EZO sensor the 'Active Device'.");
                 
                 usbSendString("\r    exit");
                 usbSendString("\r      Exit this shell.");
@@ -141,14 +139,12 @@ uint8 runCommand(void) {
                 
             case SEND:
                 sscanf(buffer, "%*s%s", argument);
-                if (activeDevice == EC_SENSOR_ADDRESS) {
-                    usbSendString("\r  Sent Command to EC Sensor: ");
-                } else if (activeDevice == DO_SENSOR_ADDRESS) {
-                    usbSendString("\r  Sent Command to DO Sensor: ");    
-                }
+                usbSendString("\r  Sent Command to ");
+                usbSendString((char*) ezoTypeName(sensor->type));
+                usbSendString(" Sensor: ");
                 usbSendString(argument);
                 
-                response = ezoSendAndPoll(activeDevice, argument, 2200);
+                response = ezoSendAndPoll(sensor->address, argument, 2200);
                 
                 usbSendString("\r  Received: ");
                 usbSendString(response.d);
@@ -166,13 +162,11 @@ uint8 runCommand(void) {
                 break;
                 
             case CHANGE_ACTIVE_DEVICE:
-                if (activeDevice == EC_SENSOR_ADDRESS) {
-                    activeDevice = DO_SENSOR_ADDRESS;
-                    usbSendString("\r  Made waterlabDO the active device");
-                } else {
-                    activeDevice = EC_SENSOR_ADDRESS;
-                    usbSendString("\r  Made waterlabEC the active device");
-                }
+                activeDevice = (activeDevice + 1) % EZO_SENSOR_COUNT;
+                sensor = ezoSensor(activeDevice);
+                usbSendString("\r  Made waterlab");
+                usbSendString((char*) ezoTypeName(sensor->type));
+                usbSendString(" the active device");
                 break;
                 
             case TOGGLE_RECIRCULATION: